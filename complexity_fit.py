@@ -0,0 +1,122 @@
+import argparse
+import math
+
+import numpy as np
+import pandas as pd
+
+# Колонки time_sorts.txt в том порядке, в котором их пишет main.cpp
+ALGORITHMS = ['std::sort()', 'bubbleSort', 'selectionSort', 'heapSort']
+
+# Модели сложности: t(n) = c * f(n)
+MODELS = {
+    'n': lambda n: n,
+    'n log n': lambda n: n * np.log2(n),
+    'n^2': lambda n: n * n,
+}
+
+
+def fit_model(n, t, f):
+    """Подбирает константу c для t = c * f(n), минимизируя относительную ошибку.
+
+    Относительная ошибка нужна, чтобы точки с большим n не подавляли остальные.
+    Возвращает константу, R^2 и среднеквадратичную относительную ошибку.
+    """
+    fn = f(n)
+    c = np.sum(fn / t) / np.sum((fn / t) ** 2)
+    predicted = c * fn
+    ss_res = np.sum((t - predicted) ** 2)
+    ss_tot = np.sum((t - t.mean()) ** 2)
+    r2 = 1.0 - ss_res / ss_tot if ss_tot > 0 else float('nan')
+    rel_rms = math.sqrt(np.mean(((predicted - t) / t) ** 2))
+    return c, r2, rel_rms
+
+
+def power_law_exponent(n, t):
+    """Эмпирический показатель степени b из t = a * n^b (регрессия в логарифмах)."""
+    b, _ = np.polyfit(np.log(n), np.log(t), 1)
+    return b
+
+
+def format_ms(ms):
+    """Переводит миллисекунды в читаемую строку."""
+    seconds = ms / 1000.0
+    if seconds < 1:
+        return f'{ms:.1f} ms'
+    if seconds < 120:
+        return f'{seconds:.1f} s'
+    if seconds < 7200:
+        return f'{seconds / 60:.1f} min'
+    if seconds < 172800:
+        return f'{seconds / 3600:.1f} h'
+    return f'{seconds / 86400:.1f} days'
+
+
+def find_cliffs(n, t, f, c, threshold, elem_bytes):
+    """Ищет скачки нормированной стоимости t / (c * f(n)) между соседними размерами.
+
+    Рост нормированной стоимости больше чем в threshold раз при переходе к следующему
+    размеру означает, что алгоритм стал дороже, чем предсказывает модель, —
+    обычно так выглядит выход рабочего набора за пределы очередного уровня кэша.
+    """
+    ratio = t / (c * f(n))
+    cliffs = []
+    for i in range(len(n) - 1):
+        jump = ratio[i + 1] / ratio[i]
+        if jump > threshold:
+            cliffs.append((n[i], n[i + 1], jump, n[i] * elem_bytes, n[i + 1] * elem_bytes))
+    return cliffs
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Подбор модели сложности по результатам time_sorts.txt')
+    parser.add_argument('file', nargs='?', default='time_sorts.txt', help='файл с замерами')
+    parser.add_argument('--predict', type=int, nargs='*', default=[100000, 1000000, 10000000, 100000000],
+                        help='размеры, для которых нужен прогноз')
+    parser.add_argument('--min-ms', type=float, default=5.0,
+                        help='точки быстрее этого порога не участвуют в подборе (мало значащих цифр)')
+    parser.add_argument('--cliff-threshold', type=float, default=1.3,
+                        help='во сколько раз должна вырасти нормированная стоимость, чтобы считать это обрывом')
+    parser.add_argument('--elem-bytes', type=int, default=56,
+                        help='размер одного LotteryTicket в байтах (для оценки рабочего набора)')
+    args = parser.parse_args()
+
+    try:
+        data = pd.read_csv(args.file, sep=r'\s+', header=None)
+    except FileNotFoundError:
+        print(f"Ошибка: файл '{args.file}' не найден.")
+        return
+    data.columns = ['X'] + ALGORITHMS[:len(data.columns) - 1]
+
+    for algorithm in data.columns[1:]:
+        # Отрицательное время означает, что замер был пропущен (--quadratic-limit)
+        usable = data[(data[algorithm] >= args.min_ms)]
+        n = usable['X'].to_numpy(dtype=float)
+        t = usable[algorithm].to_numpy(dtype=float)
+
+        print(f'=== {algorithm} ===')
+        if len(n) < 3:
+            print(f'  недостаточно точек (нужно хотя бы 3 замера от {args.min_ms} ms)\n')
+            continue
+
+        fits = {name: fit_model(n, t, f) for name, f in MODELS.items()}
+        best = min(fits, key=lambda name: fits[name][2])
+        for name, (c, r2, rel_rms) in fits.items():
+            mark = '  <- лучшая' if name == best else ''
+            print(f'  {name:8s} c = {c:.4e} ms   R^2 = {r2:.4f}   отн. ошибка = {rel_rms * 100:.1f}%{mark}')
+        print(f'  эмпирический показатель: t ~ n^{power_law_exponent(n, t):.2f}')
+
+        c = fits[best][0]
+        measured = set(data['X'][data[algorithm] >= 0])
+        for size in args.predict:
+            note = '' if size not in measured else ' (есть замер)'
+            print(f'  прогноз n = {size:>11d}: {format_ms(c * MODELS[best](float(size)))}{note}')
+
+        for lo, hi, jump, lo_bytes, hi_bytes in find_cliffs(n, t, MODELS[best], c,
+                                                              args.cliff_threshold, args.elem_bytes):
+            print(f'  ! скачок x{jump:.2f} между n = {lo:.0f} и n = {hi:.0f} '
+                  f'(~{lo_bytes / 1024:.0f} KiB -> ~{hi_bytes / 1024:.0f} KiB): возможен обрыв кэша')
+        print()
+
+
+if __name__ == '__main__':
+    main()
@@ -5,6 +5,8 @@ try:
     data = pd.read_csv('time_sorts.txt', delim_whitespace=True, header=None)
     # Присваиваем колонкам имена для удобства (необязательно, но улучшает читаемость)
     data.columns = ['X', 'Y1', 'Y2', 'Y3', 'Y4']
+    # Время -1 означает пропущенный замер (--quadratic-limit), такие точки не рисуем
+    data = data.mask(data < 0)
 
     # Шаг 2: Создание и настройка графика
     # Создаем фигуру и оси для графика. figsize задает размер окна с графиком.
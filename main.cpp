@@ -6,6 +6,9 @@
  * сортирует их с использованием четырех разных алгоритмов (std::sort, сортировка выбором,
  * пузырьковая сортировка, пирамидальная сортировка) и замеряет время их выполнения.
  * Результаты замеров сохраняются в файл для последующего анализа.
+ *
+ * Опция `--trace[=файл]` включает трассировку этапов (разбор, копирование, сортировка,
+ * проверка, запись) и сохраняет её в формате Chrome trace (chrome://tracing, ui.perfetto.dev).
  */
 
 #include <iostream>
@@ -16,9 +19,46 @@
 #include <chrono>
 #include <algorithm> 
 #include <utility>
+#include <tuple>
+#include <type_traits>
 #include <stdexcept>
 #include <random>
 #include <time.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <map>
+#include <cstdint>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <thread>
+#include <set>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <limits>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 
 /**
  * @class LotteryTicket
@@ -81,6 +121,290 @@ std::ostream& operator<<(std::ostream& os, const LotteryTicket& ticket) {
     return os;
 }
 
+// --- Упакованный ключ сортировки ---
+
+/**
+ * @brief Переводит календарную дату в номер дня от 1970-01-01 (пролептический григорианский календарь).
+ * @param y Год.
+ * @param m Месяц (1-12).
+ * @param d День месяца (1-31).
+ * @return Количество дней от 1970-01-01, отрицательное для более ранних дат.
+ */
+int daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int>(doe) - 719468;
+}
+
+/**
+ * @brief Переводит номер дня от 1970-01-01 в строку "YYYY-MM-DD".
+ * @param days Номер дня.
+ * @return Дата в формате LotteryTicket::lotteryDate.
+ */
+std::string formatDateDays(int days) {
+    days += 719468;
+    const int era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    const int y = static_cast<int>(yoe) + era * 400 + (m <= 2);
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%04d-%02u-%02u", y, m, d);
+    return buf;
+}
+
+/**
+ * @brief Разбирает дату "YYYY-MM-DD" в номер дня от 1970-01-01.
+ * @param date Строка с датой.
+ * @return Номер дня.
+ * @throws std::runtime_error Если строка не в формате "YYYY-MM-DD".
+ */
+int parseDateDays(const std::string& date) {
+    auto digit = [&](size_t i) {
+        unsigned v = static_cast<unsigned char>(date[i]) - '0';
+        if (v > 9) throw std::runtime_error("Bad date format: " + date);
+        return v;
+    };
+    if (date.size() < 10 || date[4] != '-' || date[7] != '-') {
+        throw std::runtime_error("Bad date format: " + date);
+    }
+    int y = digit(0) * 1000 + digit(1) * 100 + digit(2) * 10 + digit(3);
+    unsigned m = digit(5) * 10 + digit(6);
+    unsigned d = digit(8) * 10 + digit(9);
+    return daysFromCivil(y, m, d);
+}
+
+/**
+ * @struct PackedTicketKey
+ * @brief Ключ билета (дата, -выигрыш, номер), упакованный в два беззнаковых слова.
+ * @details Порядок ключей совпадает с LotteryTicket::operator<, поэтому ключи можно
+ *          сравнивать как целые числа и сортировать поразрядно.
+ *          hi: дата (старшие 32 бита) и инвертированный выигрыш (младшие 32 бита);
+ *          lo: номер билета. Знаковые поля сдвинуты на 2^(w-1), чтобы сохранить порядок.
+ */
+struct PackedTicketKey {
+    uint64_t hi; ///< Дата и инвертированный выигрыш.
+    uint64_t lo; ///< Номер билета.
+
+    /** @brief Лексикографическое сравнение (hi, lo). */
+    bool operator<(const PackedTicketKey& other) const {
+        return hi != other.hi ? hi < other.hi : lo < other.lo;
+    }
+    /** @brief Оператор сравнения "больше". */
+    bool operator>(const PackedTicketKey& other) const { return other < *this; }
+    /** @brief Оператор сравнения "равно". */
+    bool operator==(const PackedTicketKey& other) const { return hi == other.hi && lo == other.lo; }
+    /** @brief Оператор сравнения "не равно". */
+    bool operator!=(const PackedTicketKey& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Упаковывает поля ключа.
+ * @param date_days Дата розыгрыша, номер дня от 1970-01-01.
+ * @param win_amount Сумма выигрыша.
+ * @param ticket_number Номер билета.
+ * @return Ключ, порядок которого совпадает с порядком билетов.
+ */
+PackedTicketKey packTicketFields(int date_days, int win_amount, long long ticket_number) {
+    const uint32_t date = static_cast<uint32_t>(date_days) ^ 0x80000000u;
+    const uint32_t win = static_cast<uint32_t>(win_amount) ^ 0x80000000u;
+    const uint64_t number = static_cast<uint64_t>(ticket_number) ^ 0x8000000000000000ull;
+    return {(static_cast<uint64_t>(date) << 32) | static_cast<uint32_t>(~win), number};
+}
+
+/**
+ * @brief Упаковывает ключ билета.
+ * @param ticket Билет.
+ * @return Ключ, порядок которого совпадает с порядком билетов.
+ */
+PackedTicketKey packTicketKey(const LotteryTicket& ticket) {
+    return packTicketFields(parseDateDays(ticket.lotteryDate), ticket.winAmount, ticket.ticketNumber);
+}
+
+/** @brief Перегрузка для обобщённого кода: ключ уже упакован. */
+const PackedTicketKey& packTicketKey(const PackedTicketKey& key) { return key; }
+
+/**
+ * @struct TicketRecord
+ * @brief Билет в двоичном файле фиксированного размера (24 байта, без строк и указателей).
+ * @details Такие записи можно отобразить в память через mmap и сортировать прямо в файле.
+ */
+struct TicketRecord {
+    int64_t ticketNumber; ///< Номер билета.
+    int32_t cost;         ///< Стоимость билета.
+    int32_t winAmount;    ///< Сумма выигрыша.
+    int32_t dateDays;     ///< Дата розыгрыша, номер дня от 1970-01-01.
+    int32_t reserved;     ///< Выравнивание до 8 байт, всегда 0.
+};
+
+static_assert(sizeof(TicketRecord) == 24, "TicketRecord layout is part of the file format");
+
+/**
+ * @brief Переводит билет в двоичную запись.
+ */
+TicketRecord toTicketRecord(const LotteryTicket& ticket) {
+    return {ticket.ticketNumber, ticket.cost, ticket.winAmount, parseDateDays(ticket.lotteryDate), 0};
+}
+
+/**
+ * @brief Переводит двоичную запись обратно в билет.
+ */
+LotteryTicket fromTicketRecord(const TicketRecord& record) {
+    return LotteryTicket(record.ticketNumber, record.cost, formatDateDays(record.dateDays), record.winAmount);
+}
+
+/** @brief Упаковывает ключ двоичной записи. */
+PackedTicketKey packTicketKey(const TicketRecord& record) {
+    return packTicketFields(record.dateDays, record.winAmount, record.ticketNumber);
+}
+
+// --- Трассировка этапов выполнения ---
+
+/**
+ * @struct TraceEvent
+ * @brief Завершённый интервал трассировки (событие "X" формата Chrome trace).
+ */
+struct TraceEvent {
+    const char* name;   ///< Имя этапа (строковый литерал).
+    std::string detail; ///< Уточнение: алгоритм, размер, имя файла. Может быть пустым.
+    long long startUs;  ///< Начало интервала в микросекундах от запуска программы.
+    long long durUs;    ///< Длительность интервала в микросекундах.
+};
+
+/**
+ * @struct TraceBuffer
+ * @brief Буфер событий одного потока.
+ * @details Каждый поток пишет только в свой буфер, поэтому запись события не требует блокировок.
+ *          Буферы связаны в односвязный список, новый буфер добавляется в его голову через CAS.
+ *          Буферы живут до конца программы, чтобы события завершившихся потоков попали в экспорт.
+ */
+struct TraceBuffer {
+    std::vector<TraceEvent> events; ///< События потока в порядке завершения.
+    unsigned threadId;              ///< Порядковый номер потока в трассе.
+    TraceBuffer* next;              ///< Следующий буфер в списке.
+};
+
+std::atomic<bool> g_traceEnabled{false};            ///< Включена ли трассировка.
+std::atomic<TraceBuffer*> g_traceBuffers{nullptr};  ///< Голова списка буферов всех потоков.
+std::atomic<unsigned> g_traceThreadCount{0};        ///< Количество зарегистрированных потоков.
+const auto g_traceEpoch = std::chrono::steady_clock::now(); ///< Начало отсчёта времени трассы.
+
+/**
+ * @brief Возвращает буфер событий текущего потока, регистрируя его при первом обращении.
+ * @return Ссылка на буфер текущего потока.
+ */
+TraceBuffer& threadTraceBuffer() {
+    thread_local TraceBuffer* buffer = nullptr;
+    if (buffer == nullptr) {
+        buffer = new TraceBuffer{{}, g_traceThreadCount.fetch_add(1) + 1, g_traceBuffers.load(std::memory_order_relaxed)};
+        while (!g_traceBuffers.compare_exchange_weak(buffer->next, buffer,
+                                                     std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+    return *buffer;
+}
+
+/**
+ * @class TraceSpan
+ * @brief RAII-интервал трассировки: фиксирует время от создания до уничтожения объекта.
+ * @details При выключенной трассировке конструктор и деструктор сводятся к проверке флага.
+ */
+class TraceSpan {
+public:
+    /**
+     * @brief Открывает интервал.
+     * @param name Имя этапа. Должно быть строковым литералом или жить до экспорта трассы.
+     * @param detail Уточнение, попадающее в поле args.detail.
+     */
+    explicit TraceSpan(const char* name, std::string detail = std::string())
+        : name_(name), active_(g_traceEnabled.load(std::memory_order_relaxed)) {
+        if (active_) {
+            detail_ = std::move(detail);
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    /** @brief Закрывает интервал и записывает событие в буфер текущего потока. */
+    ~TraceSpan() {
+        if (!active_) return;
+        auto end = std::chrono::steady_clock::now();
+        auto start_us = std::chrono::duration_cast<std::chrono::microseconds>(start_ - g_traceEpoch).count();
+        auto dur_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start_).count();
+        threadTraceBuffer().events.push_back({name_, std::move(detail_), start_us, dur_us});
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    bool active_;
+    std::string detail_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @brief Экранирует строку для записи в JSON.
+ * @param text Исходная строка.
+ * @return Строка, безопасная внутри JSON-кавычек.
+ */
+std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        switch (c) {
+            case '"':  escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    escaped += buf;
+                } else {
+                    escaped += c;
+                }
+        }
+    }
+    return escaped;
+}
+
+/**
+ * @brief Сохраняет события всех потоков в файл формата Chrome trace (JSON Object Format).
+ * @details Вызывается после завершения всех рабочих потоков.
+ * @param filename Имя выходного файла.
+ * @throws std::runtime_error Если не удалось открыть файл для записи.
+ */
+void writeChromeTrace(const std::string& filename) {
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not open file for writing: " + filename);
+    }
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (TraceBuffer* buffer = g_traceBuffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->next) {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+            << ",\"args\":{\"name\":\"thread " << buffer->threadId << "\"}}";
+        first = false;
+        for (const auto& event : buffer->events) {
+            out << ",\n{\"name\":\"" << jsonEscape(event.name) << "\",\"cat\":\"lab\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << buffer->threadId << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durUs;
+            if (!event.detail.empty()) {
+                out << ",\"args\":{\"detail\":\"" << jsonEscape(event.detail) << "\"}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+}
+
 // --- Алгоритмы сортировки ---
 
 /**
@@ -159,202 +483,5571 @@ void heapSort(std::vector<T>& arr) {
 }
 
 /**
- * @brief Считывает данные о лотерейных билетах из файла.
- * @param filename Имя файла для чтения.
- * @return Вектор объектов LotteryTicket, прочитанных из файла.
- * @throws std::runtime_error Если не удалось открыть файл.
+ * @brief Числа Леонардо: размеры куч в smoothSort. L(k) = L(k-1) + L(k-2) + 1.
+ * @details 64 значений хватает на массивы до ~10^13 элементов — ровно столько разрядов в маске куч.
  */
-std::vector<LotteryTicket> readTicketsFromFile(const std::string& filename) {
-    std::vector<LotteryTicket> tickets;
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
+inline size_t leonardoNumber(int order) {
+    static const std::vector<size_t> numbers = [] {
+        std::vector<size_t> result = {1, 1};
+        while (result.size() < 64) result.push_back(result[result.size() - 1] + result[result.size() - 2] + 1);
+        return result;
+    }();
+    return numbers[order];
+}
+
+/**
+ * @brief Вспомогательная функция для smoothSort. Просеивает корень кучи Леонардо вниз.
+ * @param arr Вектор с кучами Леонардо.
+ * @param order Порядок кучи.
+ * @param head Индекс корня кучи (последний элемент кучи).
+ */
+template<typename T>
+void leonardoSift(std::vector<T>& arr, int order, size_t head) {
+    T value = std::move(arr[head]);
+    while (order > 1) {
+        const size_t right = head - 1;
+        const size_t left = head - 1 - leonardoNumber(order - 2);
+        if (!(value < arr[left]) && !(value < arr[right])) break;
+        if (!(arr[left] < arr[right])) {
+            arr[head] = std::move(arr[left]);
+            head = left;
+            order -= 1;
+        } else {
+            arr[head] = std::move(arr[right]);
+            head = right;
+            order -= 2;
+        }
     }
-    std::string line;
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string item;
-        long long num;
-        int cost, win;
-        std::string date;
+    arr[head] = std::move(value);
+}
 
-        std::getline(ss, item, ','); num = std::stoll(item);
-        std::getline(ss, item, ','); cost = std::stoi(item);
-        std::getline(ss, item, ','); date = item;
-        std::getline(ss, item, ','); win = std::stoi(item);
-        
-        tickets.emplace_back(num, cost, date, win);
+/**
+ * @brief Вспомогательная функция для smoothSort. Переносит корень кучи влево по цепочке корней,
+ *        пока корни не станут упорядочены, и просеивает его в итоговой куче.
+ * @param arr Вектор с кучами Леонардо.
+ * @param mask Маска порядков куч левее текущей (младший разряд — текущая куча).
+ * @param order Порядок текущей кучи.
+ * @param head Индекс корня текущей кучи.
+ * @param trusty true, если дети корня заведомо не больше корней соседних куч.
+ */
+template<typename T>
+void leonardoTrinkle(std::vector<T>& arr, uint64_t mask, int order, size_t head, bool trusty) {
+    T value = std::move(arr[head]);
+    while (mask != 1) {
+        const size_t stepson = head - leonardoNumber(order);
+        if (!(value < arr[stepson])) break;
+        if (!trusty && order > 1) {
+            const size_t right = head - 1;
+            const size_t left = head - 1 - leonardoNumber(order - 2);
+            if (!(arr[right] < arr[stepson]) || !(arr[left] < arr[stepson])) break;
+        }
+        arr[head] = std::move(arr[stepson]);
+        head = stepson;
+        int trail = 1;
+        while (((mask >> trail) & 1) == 0) trail++;
+        mask >>= trail;
+        order += trail;
+        trusty = false;
     }
-    return tickets;
+    arr[head] = std::move(value);
+    if (!trusty) leonardoSift(arr, order, head);
 }
 
 /**
- * @brief Записывает данные о лотерейных билетах в файл.
- * @param filename Имя файла для записи.
- * @param tickets Вектор объектов LotteryTicket для записи.
- * @throws std::runtime_error Если не удалось открыть файл для записи.
+ * @brief Реализация плавной сортировки Дейкстры (Smoothsort).
+ * @details Как heapSort, сортирует на месте за O(n log n) в худшем случае, но вместо одной двоичной
+ *          кучи держит лес куч Леонардо вдоль массива. На уже отсортированных и почти отсортированных
+ *          данных просеивания почти не двигают элементы, и время приближается к O(n).
+ *          Не устойчива.
+ * @tparam T Тип элементов в векторе. Должен поддерживать оператор '<'.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
  */
-void writeTicketsToFile(const std::string& filename, const std::vector<LotteryTicket>& tickets) {
-    std::ofstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file for writing: " + filename);
+template<typename T>
+void smoothSort(std::vector<T>& arr) {
+    const size_t n = arr.size();
+    if (n < 2) return;
+    // mask — порядки куч леса относительно order: разряд 0 — самая правая куча порядка order
+    uint64_t mask = 1;
+    int order = 1;
+    size_t head = 0;
+    for (; head < n - 1; head++) {
+        if ((mask & 3) == 3) {
+            // Две соседние кучи порядков k+1 и k сливаются с новым корнем в кучу порядка k+2
+            leonardoSift(arr, order, head);
+            mask >>= 2;
+            order += 2;
+        } else {
+            // Корень, который ещё может вырасти в большую кучу, достаточно просеять внутри кучи
+            if (leonardoNumber(order - 1) >= n - 1 - head) {
+                leonardoTrinkle(arr, mask, order, head, false);
+            } else {
+                leonardoSift(arr, order, head);
+            }
+            if (order == 1) {
+                mask <<= 1;
+                order = 0;
+            } else {
+                mask <<= order - 1;
+                order = 1;
+            }
+        }
+        mask |= 1;
     }
-    for (const auto& ticket : tickets) {
-        file << ticket << "\n";
+    leonardoTrinkle(arr, mask, order, head, false);
+
+    // Разбор: максимум всегда в корне самой правой кучи
+    while (order != 1 || mask != 1) {
+        if (order <= 1) {
+            int trail = 1;
+            while (((mask >> trail) & 1) == 0) trail++;
+            mask >>= trail;
+            order += trail;
+        } else {
+            mask <<= 2;
+            mask ^= 7;
+            order -= 2;
+            leonardoTrinkle(arr, mask >> 1, order + 1, head - leonardoNumber(order) - 1, true);
+            leonardoTrinkle(arr, mask, order, head - 1, true);
+        }
+        head--;
     }
 }
 
+// --- Гибридные и параллельные алгоритмы ---
+
 /**
- * @brief Запускает и измеряет время выполнения std::sort, выводит результат в консоль и в файл.
- * @param tickets Вектор лотерейных билетов для сортировки. Передается по значению.
+ * @struct SortTuning
+ * @brief Параметры гибридных и параллельных алгоритмов, зависящие от машины.
  */
-void benchmarkStdSort(std::vector<LotteryTicket> tickets) {
-    auto start = std::chrono::high_resolution_clock::now();
-    std::sort(tickets.begin(), tickets.end());
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    
-    std::cout << "Algorithm: std::sort"
-              << ", Time: " << duration.count() << " ms" << std::endl;
-    
-    std::string output_filename = "sorted_std_sort_" + std::to_string(tickets.size()) + ".csv";
-    writeTicketsToFile(output_filename, tickets);
-}
+struct SortTuning {
+    size_t insertionCutoff = 24;  ///< До этого размера диапазон сортируется вставками.
+    int radixDigitBits = 8;       ///< Ширина разряда поразрядной сортировки, бит (4-16).
+    size_t parallelGrain = 65536; ///< Минимальное количество элементов на поток.
+    unsigned threads = 0;         ///< Количество потоков; 0 — по числу ядер.
+    size_t radixMinSize = 1024;   ///< Начиная с этого размера адаптивный выбор предпочитает поразрядную сортировку.
+    size_t heapArity = 4;         ///< Арность кучи в dAryHeapSort.
+};
+
+SortTuning g_sortTuning; ///< Текущие параметры алгоритмов.
 
 /**
- * @brief Измеряет время выполнения std::sort.
- * @param tickets Вектор лотерейных билетов для сортировки. Передается по значению.
- * @return Время выполнения сортировки в миллисекундах.
+ * @brief Возвращает количество потоков для параллельных алгоритмов.
  */
-long long measureStdSort(std::vector<LotteryTicket> tickets) {
-    auto start = std::chrono::high_resolution_clock::now();
-    
-    std::sort(tickets.begin(), tickets.end());
-    
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+unsigned sortThreadCount() {
+    if (g_sortTuning.threads > 0) return g_sortTuning.threads;
+    return std::max(1u, std::thread::hardware_concurrency());
 }
 
 /**
- * @brief Измеряет время выполнения сортировки выбором и записывает результат в файл.
- * @param tickets Вектор лотерейных билетов для сортировки. Передается по значению.
- * @return Время выполнения сортировки в миллисекундах.
+ * @brief Выполняет fn(0), ..., fn(count - 1) в отдельных потоках и дожидается их завершения.
+ * @param count Количество задач.
+ * @param fn Задача; получает свой номер.
  */
-long long measureSelectionSort(std::vector<LotteryTicket> tickets) {
-    auto start = std::chrono::high_resolution_clock::now();
-    
-    selectionSort(tickets);
-    
-    auto end = std::chrono::high_resolution_clock::now();
-
-    std::string filename = "lottery_selection_sort_" + std::to_string(tickets.size());
-    std::ofstream out;          
-    out.open(filename);
-    for(int i = 0; i < tickets.size(); i++){
-        out << tickets[i] << std::endl;
+void parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < count; i++) {
+        workers.emplace_back(fn, i);
     }
-    out.close(); 
-
-    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    if (count > 0) fn(0);
+    for (auto& worker : workers) worker.join();
 }
 
 /**
- * @brief Измеряет время выполнения пузырьковой сортировки и записывает результат в файл.
- * @param tickets Вектор лотерейных билетов для сортировки. Передается по значению.
- * @return Время выполнения сортировки в миллисекундах.
+ * @brief Пирамидальная сортировка на d-арной куче.
+ * @details При большей арности куча ниже, а дети узла лежат рядом в памяти, поэтому
+ *          просеивание делает меньше промахов кэша ценой большего числа сравнений на уровне.
+ *          Арность берётся из g_sortTuning.heapArity.
+ * @tparam T Тип элементов в векторе. Должен поддерживать оператор '<'.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
  */
-long long measureBubbleSort(std::vector<LotteryTicket> tickets) {
-    auto start = std::chrono::high_resolution_clock::now();
-
-    bubbleSort(tickets);
-    
-    auto end = std::chrono::high_resolution_clock::now();
-
-    std::string filename = "lottery_bubble_sort_" + std::to_string(tickets.size());
-    std::ofstream out;         
-    out.open(filename);
-    for(int i = 0; i < tickets.size(); i++){
-        out << tickets[i] << std::endl;
+template<typename T>
+void dAryHeapSort(std::vector<T>& arr) {
+    const size_t d = std::max<size_t>(2, g_sortTuning.heapArity);
+    const size_t n = arr.size();
+    if (n < 2) return;
+    auto siftDown = [&](size_t i, size_t size) {
+        T value = std::move(arr[i]);
+        while (true) {
+            size_t first = i * d + 1;
+            if (first >= size) break;
+            size_t last = std::min(first + d, size);
+            size_t largest = first;
+            for (size_t c = first + 1; c < last; c++) {
+                if (arr[largest] < arr[c]) largest = c;
+            }
+            if (!(value < arr[largest])) break;
+            arr[i] = std::move(arr[largest]);
+            i = largest;
+        }
+        arr[i] = std::move(value);
+    };
+    for (size_t i = (n - 2) / d + 1; i-- > 0;) siftDown(i, n);
+    for (size_t end = n - 1; end > 0; end--) {
+        std::swap(arr[0], arr[end]);
+        siftDown(0, end);
     }
-    out.close(); 
-
-    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 }
 
 /**
- * @brief Измеряет время выполнения пирамидальной сортировки и записывает результат в файл.
- * @param tickets Вектор лотерейных билетов для сортировки. Передается по значению.
- * @return Время выполнения сортировки в миллисекундах.
+ * @brief Сортировка с выдачей результата по мере готовности: наименьшие элементы отдаются потребителю
+ *        до того, как отсортирован весь массив.
+ * @details d-арная min-куча строится за O(n), после чего корень раз за разом уходит в emit и в хвост
+ *          массива. Первый элемент готов сразу после построения кучи — задолго до конца сортировки;
+ *          каждый следующий стоит O(log n). Хвост копится в порядке убывания, поэтому в конце массив
+ *          разворачивается и тоже оказывается отсортированным. Арность — g_sortTuning.heapArity.
+ * @tparam T Тип элементов в векторе. Должен поддерживать оператор '<'.
+ * @tparam Emit Вызываемый объект void(const T&).
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ * @param emit Получает элементы в порядке возрастания.
  */
-long long measureHeapSort(std::vector<LotteryTicket> tickets) {
-    auto start = std::chrono::high_resolution_clock::now();
-
-    heapSort(tickets);
-
-    auto end = std::chrono::high_resolution_clock::now();
-
-    std::string filename = "lottery_heap_sort_" + std::to_string(tickets.size());
-    std::ofstream out;          
-    out.open(filename);
-    for(int i = 0; i < tickets.size(); i++){
-        out << tickets[i] << std::endl;
+template<typename T, typename Emit>
+void progressiveSort(std::vector<T>& arr, Emit&& emit) {
+    const size_t d = std::max<size_t>(2, g_sortTuning.heapArity);
+    const size_t n = arr.size();
+    if (n == 0) return;
+    auto siftDown = [&](size_t i, size_t size) {
+        T value = std::move(arr[i]);
+        while (true) {
+            size_t first = i * d + 1;
+            if (first >= size) break;
+            size_t last = std::min(first + d, size);
+            size_t smallest = first;
+            for (size_t c = first + 1; c < last; c++) {
+                if (arr[c] < arr[smallest]) smallest = c;
+            }
+            if (!(arr[smallest] < value)) break;
+            arr[i] = std::move(arr[smallest]);
+            i = smallest;
+        }
+        arr[i] = std::move(value);
+    };
+    if (n > 1) {
+        for (size_t i = (n - 2) / d + 1; i-- > 0;) siftDown(i, n);
     }
-    out.close(); 
+    for (size_t end = n - 1; end > 0; end--) {
+        std::swap(arr[0], arr[end]);
+        emit(static_cast<const T&>(arr[end]));
+        siftDown(0, end);
+    }
+    emit(static_cast<const T&>(arr[0]));
+    std::reverse(arr.begin(), arr.end());
+}
 
-    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+/**
+ * @brief Сортировка вставками диапазона [lo, hi).
+ * @tparam T Тип элементов в векторе. Должен поддерживать оператор '<'.
+ * @param arr Вектор элементов.
+ * @param lo Начало диапазона.
+ * @param hi Конец диапазона.
+ */
+template<typename T>
+void insertionSortRange(std::vector<T>& arr, size_t lo, size_t hi) {
+    for (size_t i = lo + 1; i < hi; i++) {
+        T value = std::move(arr[i]);
+        size_t j = i;
+        while (j > lo && value < arr[j - 1]) {
+            arr[j] = std::move(arr[j - 1]);
+            j--;
+        }
+        arr[j] = std::move(value);
+    }
 }
 
 /**
- * @brief Главная функция программы.
- * @details Функция выполняет следующие шаги:
- * 1. Определяет размеры наборов данных для тестирования.
- * 2. Читает данные о лотерейных билетах из соответствующих файлов.
- * 3. Запускает замеры времени для четырех алгоритмов сортировки (std::sort, Bubble, Selection, Heap) на каждом наборе данных.
- * 4. Записывает результаты замеров (размер массива и время для каждого алгоритма) в файл "time_sorts.txt".
- * @return 0 в случае успешного выполнения.
+ * @brief Реализация сортировки вставками.
+ * @tparam T Тип элементов в векторе. Должен поддерживать оператор '<'.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
  */
-int main(){
-    std::vector<std::string> filenames;
-    std::vector<int> arr_size = {100, 500, 1000, 2500, 5000, 7500, 10000, 12500, 15000, 20000, 30000, 40000, 50000, 60000, 80000, 100000};
+template<typename T>
+void insertionSort(std::vector<T>& arr) {
+    insertionSortRange(arr, 0, arr.size());
+}
 
-    // Загрузка данных
-    std::vector<std::vector<LotteryTicket>> arrs_tickets;
-    for(auto el: arr_size){
-        filenames.push_back("lottery_" + std::to_string(el) + ".txt");
+/**
+ * @brief Поразрядная сортировка (LSD) по упакованному ключу (дата, -выигрыш, номер).
+ * @details Сортирует пары (ключ, индекс), затем переставляет элементы за один проход.
+ *          Гистограммы всех разрядов строятся за один проход; разряды, одинаковые у всех
+ *          ключей (например, старшие биты даты), пропускаются. Требует O(n) доп. памяти.
+ * @tparam T LotteryTicket или PackedTicketKey (любой тип с перегрузкой packTicketKey).
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ */
+template<typename T>
+void radixSort(std::vector<T>& arr) {
+    const size_t n = arr.size();
+    if (n < 2) return;
+    if (n > UINT32_MAX) {
+        std::sort(arr.begin(), arr.end());
+        return;
     }
-
-    for(auto name: filenames){
-        arrs_tickets.push_back(readTicketsFromFile(name));
+    struct Item {
+        PackedTicketKey key;
+        uint32_t index;
+    };
+    std::vector<Item> items(n), buffer(n);
+    for (size_t i = 0; i < n; i++) {
+        items[i] = {packTicketKey(arr[i]), static_cast<uint32_t>(i)};
     }
 
-    // Замеры скорости 
-    std::vector<long long> std_sort_times;
-    for(auto arr : arrs_tickets){
-        std_sort_times.push_back(measureStdSort(arr));
-    }
+    const int bits = std::min(16, std::max(4, g_sortTuning.radixDigitBits));
+    const int digits = (128 + bits - 1) / bits;
+    const size_t radix = size_t(1) << bits;
+    auto digitOf = [&](const PackedTicketKey& key, int d) -> size_t {
+        const int shift = d * bits;
+        uint64_t value;
+        if (shift >= 64) {
+            value = key.hi >> (shift - 64);
+        } else if (shift + bits <= 64) {
+            value = key.lo >> shift;
+        } else {
+            value = (key.lo >> shift) | (key.hi << (64 - shift));
+        }
+        return static_cast<size_t>(value) & (radix - 1);
+    };
 
-    std::vector<long long> std_bubble_times;
-    for(auto arr : arrs_tickets){
-        std_bubble_times.push_back(measureBubbleSort(arr));
+    std::vector<size_t> counts(static_cast<size_t>(digits) * radix, 0);
+    for (const auto& item : items) {
+        for (int d = 0; d < digits; d++) {
+            counts[d * radix + digitOf(item.key, d)]++;
+        }
+    }
+    for (int d = 0; d < digits; d++) {
+        size_t* count = &counts[d * radix];
+        if (count[digitOf(items[0].key, d)] == n) continue; // разряд одинаков у всех ключей
+        size_t offset = 0;
+        for (size_t b = 0; b < radix; b++) {
+            size_t c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (const auto& item : items) {
+            buffer[count[digitOf(item.key, d)]++] = item;
+        }
+        items.swap(buffer);
     }
 
-    std::vector<long long> std_selection_times;
-    for(auto arr : arrs_tickets){
-        std_selection_times.push_back(measureSelectionSort(arr));
+    std::vector<T> sorted;
+    sorted.reserve(n);
+    for (const auto& item : items) {
+        sorted.push_back(std::move(arr[item.index]));
     }
+    arr.swap(sorted);
+}
 
-    std::vector<long long> std_heap_times;
-    for(auto arr : arrs_tickets){
-        std_heap_times.push_back(measureHeapSort(arr));
+/**
+ * @brief Один уровень American flag sort над [lo, hi): подсчёт байта, обмены по циклам, рекурсия в корзины.
+ * @tparam Item Элемент с готовым ключом.
+ * @tparam KeyOf Вызываемый объект const PackedTicketKey&(const Item&).
+ * @param items Элементы.
+ * @param lo Начало диапазона.
+ * @param hi Конец диапазона.
+ * @param level Номер байта ключа, 0 — старший.
+ * @param keyOf Доступ к ключу элемента.
+ * @param cutoff До этого размера диапазон сортируется вставками.
+ */
+template<typename Item, typename KeyOf>
+void americanFlagSortRange(std::vector<Item>& items, size_t lo, size_t hi, int level, const KeyOf& keyOf, size_t cutoff) {
+    auto digitOf = [&](const Item& item) -> size_t {
+        const PackedTicketKey& key = keyOf(item);
+        const uint64_t word = level < 8 ? key.hi : key.lo;
+        return static_cast<size_t>((word >> (56 - 8 * (level % 8))) & 0xFF);
+    };
+    while (level < 16) {
+        if (hi - lo <= cutoff) {
+            for (size_t i = lo + 1; i < hi; i++) {
+                Item value = std::move(items[i]);
+                size_t j = i;
+                while (j > lo && keyOf(value) < keyOf(items[j - 1])) {
+                    items[j] = std::move(items[j - 1]);
+                    j--;
+                }
+                items[j] = std::move(value);
+            }
+            return;
+        }
+        size_t counts[256] = {0};
+        for (size_t i = lo; i < hi; i++) counts[digitOf(items[i])]++;
+        if (counts[digitOf(items[lo])] == hi - lo) {
+            level++;
+            continue;
+        }
+        size_t next[256], ends[256];
+        size_t offset = lo;
+        for (size_t b = 0; b < 256; b++) {
+            next[b] = offset;
+            offset += counts[b];
+            ends[b] = offset;
+        }
+        for (size_t b = 0; b < 256; b++) {
+            while (next[b] < ends[b]) {
+                const size_t d = digitOf(items[next[b]]);
+                if (d == b) {
+                    next[b]++;
+                } else {
+                    std::swap(items[next[b]], items[next[d]++]);
+                }
+            }
+        }
+        size_t start = lo;
+        for (size_t b = 0; b < 256; b++) {
+            if (counts[b] > 1) americanFlagSortRange(items, start, start + counts[b], level + 1, keyOf, cutoff);
+            start += counts[b];
+        }
+        return;
+    }
+}
+
+/**
+ * @brief Поразрядная сортировка MSD (American flag sort) по упакованному ключу.
+ * @details На каждом уровне один проход считает байты ключа начиная со старшего, затем элементы
+ *          расставляются по корзинам обменами по циклам (cycle leader) — без буфера на n элементов,
+ *          в отличие от radixSort. Уровень, на котором все элементы попали в одну корзину
+ *          (например, старшие байты даты), сразу пропускается. Корзины не больше
+ *          g_sortTuning.insertionCutoff досортировываются вставками. Ключи упаковываются один раз:
+ *          сортируются пары (ключ, исходная позиция), а сами билеты переставляются в конце по циклам,
+ *          каждый перемещается один раз. Доп. память — 24 байта на элемент; PackedTicketKey
+ *          сортируется прямо на месте.
+ * @tparam T LotteryTicket или PackedTicketKey (любой тип с перегрузкой packTicketKey).
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ */
+template<typename T>
+void americanFlagSort(std::vector<T>& arr) {
+    const size_t n = arr.size();
+    if (n < 2) return;
+    const size_t cutoff = std::max<size_t>(g_sortTuning.insertionCutoff, 1);
+    if constexpr (std::is_same<T, PackedTicketKey>::value) {
+        americanFlagSortRange(arr, 0, n, 0, [](const PackedTicketKey& key) -> const PackedTicketKey& { return key; }, cutoff);
+    } else {
+        struct Item {
+            PackedTicketKey key;
+            size_t index;
+        };
+        std::vector<Item> items(n);
+        for (size_t i = 0; i < n; i++) items[i] = {packTicketKey(arr[i]), i};
+        americanFlagSortRange(items, 0, n, 0, [](const Item& item) -> const PackedTicketKey& { return item.key; }, cutoff);
+        // На место i встаёт arr[items[i].index]; разобранные позиции помечаются index == i
+        for (size_t i = 0; i < n; i++) {
+            if (items[i].index == i) continue;
+            T value = std::move(arr[i]);
+            size_t j = i;
+            while (items[j].index != i) {
+                const size_t source = items[j].index;
+                arr[j] = std::move(arr[source]);
+                items[j].index = j;
+                j = source;
+            }
+            arr[j] = std::move(value);
+            items[j].index = j;
+        }
+    }
+}
+
+/**
+ * @brief Естественная сортировка слиянием: сливает уже упорядоченные участки входа.
+ * @details Убывающие участки разворачиваются, участки короче g_sortTuning.insertionCutoff
+ *          дополняются сортировкой вставками. На данных из r участков работает за O(n log r),
+ *          на уже отсортированных — за один проход.
+ * @tparam T Тип элементов в векторе. Должен поддерживать оператор '<'.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ */
+template<typename T>
+void naturalMergeSort(std::vector<T>& arr) {
+    const size_t n = arr.size();
+    std::vector<size_t> bounds{0};
+    for (size_t i = 0; i < n;) {
+        size_t j = i + 1;
+        if (j < n && arr[j] < arr[i]) {
+            while (j < n && arr[j] < arr[j - 1]) j++;
+            std::reverse(arr.begin() + i, arr.begin() + j);
+        } else {
+            while (j < n && !(arr[j] < arr[j - 1])) j++;
+        }
+        // Короткие участки добиваются вставками до insertionCutoff, как minrun в TimSort
+        if (j - i < g_sortTuning.insertionCutoff && j < n) {
+            j = std::min(n, i + g_sortTuning.insertionCutoff);
+            insertionSortRange(arr, i, j);
+        }
+        bounds.push_back(j);
+        i = j;
+    }
+    while (bounds.size() > 2) {
+        std::vector<size_t> next{0};
+        for (size_t k = 0; k + 2 < bounds.size(); k += 2) {
+            std::inplace_merge(arr.begin() + bounds[k], arr.begin() + bounds[k + 1], arr.begin() + bounds[k + 2]);
+            next.push_back(bounds[k + 2]);
+        }
+        if ((bounds.size() - 1) % 2 == 1) next.push_back(bounds.back());
+        bounds.swap(next);
+    }
+}
+
+/**
+ * @brief Параллельная сортировка: std::sort частей в отдельных потоках и попарное слияние.
+ * @details Количество частей ограничено числом потоков и g_sortTuning.parallelGrain.
+ * @tparam T Тип элементов в векторе. Должен поддерживать оператор '<'.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ */
+template<typename T>
+void parallelSort(std::vector<T>& arr) {
+    const size_t n = arr.size();
+    const size_t chunks = std::min<size_t>(sortThreadCount(), n / std::max<size_t>(g_sortTuning.parallelGrain, 1));
+    if (chunks <= 1) {
+        std::sort(arr.begin(), arr.end());
+        return;
+    }
+    std::vector<size_t> bounds(chunks + 1);
+    for (size_t c = 0; c <= chunks; c++) {
+        bounds[c] = n * c / chunks;
+    }
+    parallelFor(chunks, [&](size_t c) {
+        std::sort(arr.begin() + bounds[c], arr.begin() + bounds[c + 1]);
+    });
+    while (bounds.size() > 2) {
+        const size_t pairs = (bounds.size() - 1) / 2;
+        parallelFor(pairs, [&](size_t p) {
+            std::inplace_merge(arr.begin() + bounds[2 * p], arr.begin() + bounds[2 * p + 1], arr.begin() + bounds[2 * p + 2]);
+        });
+        std::vector<size_t> next;
+        for (size_t k = 0; k < bounds.size(); k += 2) next.push_back(bounds[k]);
+        if (next.back() != n) next.push_back(n);
+        bounds.swap(next);
+    }
+}
+
+/**
+ * @struct NumaNode
+ * @brief Узел NUMA: сокет (или его часть) со своей памятью и списком процессоров.
+ */
+struct NumaNode {
+    int id;                ///< Номер узла.
+    std::vector<int> cpus; ///< Процессоры узла.
+};
+
+/**
+ * @brief Разбирает список процессоров в формате sysfs, например "0-3,8-11".
+ */
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    for (std::string range; std::getline(ss, range, ',');) {
+        if (range.empty()) continue;
+        const size_t dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+/**
+ * @brief Определяет узлы NUMA по /sys/devices/system/node.
+ * @return Узлы с процессорами; один узел со всеми процессорами, если топология недоступна.
+ */
+std::vector<NumaNode> detectNumaNodes() {
+    std::vector<NumaNode> nodes;
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string list;
+    if (std::getline(online, list)) {
+        for (int id : parseCpuList(list)) {
+            std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string cpus;
+            if (std::getline(cpulist, cpus) && !parseCpuList(cpus).empty()) nodes.push_back({id, parseCpuList(cpus)});
+        }
+    }
+    if (nodes.empty()) {
+        NumaNode all{0, {}};
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++) all.cpus.push_back(static_cast<int>(cpu));
+        nodes.push_back(all);
+    }
+    return nodes;
+}
+
+/**
+ * @class CpuPin
+ * @brief Привязывает текущий поток к процессору на время жизни объекта (Linux), затем восстанавливает маску.
+ * @details Память, к которой поток обращается первым (first touch), ядро выделяет на узле этого процессора.
+ */
+class CpuPin {
+public:
+    /** @brief Привязывает поток к cpu; на других системах ничего не делает. */
+    explicit CpuPin(int cpu) {
+#ifdef __linux__
+        pinned_ = sched_getaffinity(0, sizeof(saved_), &saved_) == 0;
+        if (pinned_) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pinned_ = sched_setaffinity(0, sizeof(set), &set) == 0;
+        }
+#else
+        (void)cpu;
+#endif
+    }
+
+    CpuPin(const CpuPin&) = delete;
+    CpuPin& operator=(const CpuPin&) = delete;
+
+    /** @brief Восстанавливает прежнюю маску процессоров. */
+    ~CpuPin() {
+#ifdef __linux__
+        if (pinned_) sched_setaffinity(0, sizeof(saved_), &saved_);
+#endif
+    }
+
+private:
+#ifdef __linux__
+    cpu_set_t saved_;
+#endif
+    bool pinned_ = false;
+};
+
+/**
+ * @brief Параллельная сортировка с учётом NUMA: локальная сортировка на узлах и обмен по разделителям.
+ * @details 1) Каждый поток привязывается к процессору; потоки раскладываются по узлам пропорционально
+ *          числу процессоров. Поток переносит свою часть входа в собственный вектор — первое
+ *          обращение размещает его страницы в памяти своего узла — и сортирует его там.
+ *          2) Из каждого отсортированного участка берётся регулярная выборка, по ней выбираются
+ *          разделители — по одному на границу между потоками.
+ *          3) Каждый поток двоичным поиском находит в каждом участке свой диапазон ключей
+ *          и сливает эти куски сразу в итоговое место массива. Через межсокетную шину каждый
+ *          элемент проходит не больше одного раза, а не log(потоков) раз, как при попарных слияниях.
+ *          Доп. память — O(n) (локальные копии участков).
+ * @tparam T Тип элементов в векторе. Должен поддерживать оператор '<'.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ */
+template<typename T>
+void numaSort(std::vector<T>& arr) {
+    const size_t n = arr.size();
+    const size_t threads = std::min<size_t>(sortThreadCount(), n / std::max<size_t>(g_sortTuning.parallelGrain, 1));
+    if (threads <= 1) {
+        std::sort(arr.begin(), arr.end());
+        return;
+    }
+    // Процессоры по узлам подряд: соседние потоки попадают на один узел
+    std::vector<int> cpus;
+    for (const auto& node : detectNumaNodes()) cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+
+    std::vector<std::vector<T>> runs(threads);
+    parallelFor(threads, [&](size_t t) {
+        CpuPin pin(cpus[t * cpus.size() / threads]);
+        const size_t lo = n * t / threads, hi = n * (t + 1) / threads;
+        runs[t].assign(std::make_move_iterator(arr.begin() + lo), std::make_move_iterator(arr.begin() + hi));
+        std::sort(runs[t].begin(), runs[t].end());
+    });
+
+    const size_t per_run = 16 * threads;
+    std::vector<T> sample;
+    for (const auto& run : runs) {
+        for (size_t i = 1; i <= per_run; i++) sample.push_back(run[run.size() * i / (per_run + 1)]);
+    }
+    std::sort(sample.begin(), sample.end());
+    std::vector<T> splitters;
+    for (size_t t = 1; t < threads; t++) splitters.push_back(sample[sample.size() * t / threads]);
+
+    // cuts[t][r] — начало диапазона потока t в участке r
+    std::vector<std::vector<size_t>> cuts(threads + 1, std::vector<size_t>(threads));
+    for (size_t r = 0; r < threads; r++) {
+        cuts[0][r] = 0;
+        cuts[threads][r] = runs[r].size();
+        for (size_t t = 1; t < threads; t++) {
+            cuts[t][r] = std::lower_bound(runs[r].begin(), runs[r].end(), splitters[t - 1]) - runs[r].begin();
+        }
+    }
+    std::vector<size_t> offsets(threads + 1, 0);
+    for (size_t t = 0; t <= threads; t++) {
+        for (size_t r = 0; r < threads; r++) offsets[t] += cuts[t][r];
+    }
+
+    parallelFor(threads, [&](size_t t) {
+        CpuPin pin(cpus[t * cpus.size() / threads]);
+        std::vector<size_t> pos(cuts[t]);
+        auto later = [&](size_t a, size_t b) { return runs[b][pos[b]] < runs[a][pos[a]]; };
+        std::vector<size_t> heap;
+        for (size_t r = 0; r < threads; r++) {
+            if (pos[r] < cuts[t + 1][r]) heap.push_back(r);
+        }
+        std::make_heap(heap.begin(), heap.end(), later);
+        for (size_t out = offsets[t]; !heap.empty(); out++) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            const size_t r = heap.back();
+            arr[out] = std::move(runs[r][pos[r]++]);
+            if (pos[r] < cuts[t + 1][r]) {
+                std::push_heap(heap.begin(), heap.end(), later);
+            } else {
+                heap.pop_back();
+            }
+        }
+    });
+}
+
+/**
+ * @brief Быстрая сортировка с трёхчастным разбиением Бентли — Макилроя.
+ * @details Равные опорному элементы собираются по краям диапазона во время разбиения,
+ *          а затем переносятся в середину и в рекурсию не попадают. При k различных ключах
+ *          время O(n log k), на данных из одинаковых ключей — линейное. Опорный элемент —
+ *          медиана трёх (нинтер на больших диапазонах), короткие диапазоны досортировываются
+ *          вставками, при слишком глубокой рекурсии диапазон досортировывается через кучу.
+ * @tparam T Тип элементов в векторе.
+ * @tparam Compare Строгое слабое упорядочение; по умолчанию operator<.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ * @param comp Функция сравнения, например только по (дате, выигрышу).
+ */
+template<typename T, typename Compare = std::less<T>>
+void quickSort3Way(std::vector<T>& arr, Compare comp = Compare()) {
+    auto equal = [&](const T& a, const T& b) { return !comp(a, b) && !comp(b, a); };
+    auto median3 = [&](long long a, long long b, long long c) {
+        if (comp(arr[a], arr[b])) return comp(arr[b], arr[c]) ? b : (comp(arr[a], arr[c]) ? c : a);
+        return comp(arr[a], arr[c]) ? a : (comp(arr[b], arr[c]) ? c : b);
+    };
+    const long long cutoff = static_cast<long long>(std::max<size_t>(g_sortTuning.insertionCutoff, 1));
+
+    // Диапазоны включительные: [lo, hi]
+    std::function<void(long long, long long, int)> sortRange = [&](long long lo, long long hi, int depth) {
+        while (hi - lo + 1 > cutoff) {
+            if (depth-- == 0) {
+                std::make_heap(arr.begin() + lo, arr.begin() + hi + 1, comp);
+                std::sort_heap(arr.begin() + lo, arr.begin() + hi + 1, comp);
+                return;
+            }
+            const long long n = hi - lo + 1, mid = lo + n / 2;
+            long long pivot = median3(lo, mid, hi);
+            if (n > 40) {
+                const long long e = n / 8;
+                pivot = median3(median3(lo, lo + e, lo + 2 * e), median3(mid - e, mid, mid + e),
+                                median3(hi - 2 * e, hi - e, hi));
+            }
+            std::swap(arr[lo], arr[pivot]);
+            const T& v = arr[lo];
+
+            long long i = lo, j = hi + 1, p = lo, q = hi + 1;
+            while (true) {
+                while (comp(arr[++i], v)) if (i == hi) break;
+                while (comp(v, arr[--j])) if (j == lo) break;
+                if (i == j && equal(arr[i], v)) std::swap(arr[++p], arr[i]);
+                if (i >= j) break;
+                std::swap(arr[i], arr[j]);
+                if (equal(arr[i], v)) std::swap(arr[++p], arr[i]);
+                if (equal(arr[j], v)) std::swap(arr[--q], arr[j]);
+            }
+            i = j + 1;
+            for (long long k = lo; k <= p; k++) std::swap(arr[k], arr[j--]);
+            for (long long k = hi; k >= q; k--) std::swap(arr[k], arr[i++]);
+
+            // Рекурсия в меньшую часть, цикл по большей: глубина стека O(log n)
+            if (j - lo < hi - i) {
+                sortRange(lo, j, depth);
+                lo = i;
+            } else {
+                sortRange(i, hi, depth);
+                hi = j;
+            }
+        }
+        for (long long k = lo + 1; k <= hi; k++) {
+            T value = std::move(arr[k]);
+            long long m = k;
+            while (m > lo && comp(value, arr[m - 1])) {
+                arr[m] = std::move(arr[m - 1]);
+                m--;
+            }
+            arr[m] = std::move(value);
+        }
+    };
+    if (arr.size() < 2) return;
+    int depth = 0;
+    for (size_t n = arr.size(); n > 1; n >>= 1) depth += 2;
+    sortRange(0, static_cast<long long>(arr.size()) - 1, depth);
+}
+
+/**
+ * @struct DeadlineSortReport
+ * @brief Результат sortWithDeadline: докуда массив успел упорядочиться.
+ */
+struct DeadlineSortReport {
+    size_t sortedPrefix = 0; ///< Позиции [0, sortedPrefix) стоят на своих окончательных местах.
+    size_t partitions = 0;   ///< На сколько упорядоченных между собой блоков разбит остаток.
+    bool completed = false;  ///< Массив отсортирован целиком.
+    double elapsedMs = 0;    ///< Фактически затраченное время.
+};
+
+/**
+ * @brief Сортировка с жёстким сроком: к моменту budget гарантированно отсортирован префикс массива.
+ * @details Инкрементальная быстрая сортировка: в стеке лежат правые границы ещё не упорядоченных блоков,
+ *          каждый блок целиком не больше следующего. Обрабатывается всегда самый левый блок — он
+ *          разбивается на три части (меньше, равно, больше опорного), а короткий досортировывается
+ *          вставками и присоединяется к префиксу. Часы проверяются на каждом шаге и каждые 4096 элементов
+ *          внутри разбиения; прерванное разбиение лишь переставляет элементы внутри своего блока, так что
+ *          при остановке префикс точен, а остаток разбит на упорядоченные между собой блоки. Ожидаемое
+ *          время полной сортировки O(n log n), префикс из k элементов готов за O(n + k log k).
+ * @tparam T Тип элементов в векторе. Должен поддерживать оператор '<'.
+ * @param arr Вектор элементов. Упорядочивается на месте, насколько позволит срок.
+ * @param budget Бюджет времени.
+ * @return Отчёт о том, докуда дошла сортировка.
+ */
+template<typename T>
+DeadlineSortReport sortWithDeadline(std::vector<T>& arr, std::chrono::steady_clock::duration budget) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + budget;
+    const size_t cutoff = std::max<size_t>(g_sortTuning.insertionCutoff, 1);
+    auto median3 = [&](size_t a, size_t b, size_t c) {
+        if (arr[a] < arr[b]) return arr[b] < arr[c] ? b : (arr[a] < arr[c] ? c : a);
+        return arr[a] < arr[c] ? a : (arr[b] < arr[c] ? c : b);
+    };
+
+    DeadlineSortReport report;
+    std::vector<size_t> ends = {arr.size()};
+    size_t lo = 0;
+    bool expired = false;
+    while (!ends.empty()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            expired = true;
+            break;
+        }
+        const size_t hi = ends.back();
+        if (hi - lo <= cutoff) {
+            insertionSortRange(arr, lo, hi);
+            ends.pop_back();
+            lo = hi;
+            continue;
+        }
+        const size_t n = hi - lo, mid = lo + n / 2;
+        size_t pivot = median3(lo, mid, hi - 1);
+        if (n > 40) {
+            const size_t e = n / 8;
+            pivot = median3(median3(lo, lo + e, lo + 2 * e), median3(mid - e, mid, mid + e),
+                            median3(hi - 1 - 2 * e, hi - 1 - e, hi - 1));
+        }
+        const T v = arr[pivot];
+        // Разбиение Дейкстры: [lo, lt) < v, [lt, i) == v, [gt, hi) > v
+        // Часы проверяются по числу шагов: на ветке "больше" i стоит на месте, двигается gt
+        size_t lt = lo, i = lo, gt = hi;
+        for (size_t step = 1; i < gt; step++) {
+            if ((step & 4095) == 0 && std::chrono::steady_clock::now() >= deadline) {
+                expired = true;
+                break;
+            }
+            if (arr[i] < v) {
+                std::swap(arr[lt++], arr[i++]);
+            } else if (v < arr[i]) {
+                std::swap(arr[i], arr[--gt]);
+            } else {
+                i++;
+            }
+        }
+        if (expired) break;
+        ends.pop_back();
+        if (gt < hi) ends.push_back(hi);
+        if (lt == lo) {
+            // Левая часть пуста: равные опорному сразу присоединяются к префиксу
+            lo = gt;
+        } else {
+            ends.push_back(gt);
+            ends.push_back(lt);
+        }
+    }
+    report.sortedPrefix = lo;
+    report.partitions = ends.size();
+    report.completed = !expired && ends.empty();
+    report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+/**
+ * @brief Устойчиво сливает соседние отсортированные диапазоны [a, m) и [m, b) без буфера (SymMerge).
+ * @details Алгоритм Кима и Куцнера: двоичным поиском находится симметричная точка разреза,
+ *          средняя часть переставляется поворотом, и две получившиеся пары диапазонов сливаются
+ *          рекурсивно. O(n log n) перемещений, O(log n) глубина рекурсии.
+ */
+template<typename T, typename Compare>
+void symMerge(std::vector<T>& arr, size_t a, size_t m, size_t b, Compare& comp) {
+    if (a >= m || m >= b || !comp(arr[m], arr[m - 1])) return;
+    if (m - a == 1) {
+        // Один элемент слева: вставка после всех, которые не больше него
+        const size_t pos = std::lower_bound(arr.begin() + m, arr.begin() + b, arr[a], comp) - arr.begin();
+        std::rotate(arr.begin() + a, arr.begin() + m, arr.begin() + pos);
+        return;
+    }
+    if (b - m == 1) {
+        // Один элемент справа: вставка перед первым, который больше него
+        const size_t pos = std::upper_bound(arr.begin() + a, arr.begin() + m, arr[m], comp) - arr.begin();
+        std::rotate(arr.begin() + pos, arr.begin() + m, arr.begin() + b);
+        return;
+    }
+    const size_t mid = a + (b - a) / 2;
+    const size_t n = mid + m;
+    size_t start, r;
+    if (m > mid) {
+        start = n - b;
+        r = mid;
+    } else {
+        start = a;
+        r = m;
+    }
+    const size_t p = n - 1;
+    while (start < r) {
+        const size_t c = start + (r - start) / 2;
+        if (!comp(arr[p - c], arr[c])) {
+            start = c + 1;
+        } else {
+            r = c;
+        }
+    }
+    const size_t end = n - start;
+    if (start < m && m < end) std::rotate(arr.begin() + start, arr.begin() + m, arr.begin() + end);
+    if (a < start && start < mid) symMerge(arr, a, start, mid, comp);
+    if (mid < end && end < b) symMerge(arr, mid, end, b, comp);
+}
+
+/**
+ * @brief Устойчивая сортировка слиянием на месте, без буфера размера n.
+ * @details Массив делится на блоки по 20 элементов, каждый сортируется вставками, затем блоки
+ *          попарно сливаются снизу вверх через symMerge. Время O(n log² n), дополнительная
+ *          память O(1) (кроме стека глубины O(log n)), в отличие от std::stable_sort,
+ *          которому нужен временный буфер на n элементов. Уже упорядоченные пары блоков
+ *          не сливаются, так что на отсортированных данных время близко к линейному.
+ * @tparam T Тип элементов в векторе.
+ * @tparam Compare Строгое слабое упорядочение; по умолчанию operator<.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ * @param comp Функция сравнения, например только по дате: равные по ней билеты сохраняют порядок.
+ */
+template<typename T, typename Compare = std::less<T>>
+void blockMergeSort(std::vector<T>& arr, Compare comp = Compare()) {
+    const size_t n = arr.size();
+    const size_t block = 20;
+    for (size_t lo = 0; lo < n; lo += block) {
+        const size_t hi = std::min(lo + block, n);
+        for (size_t k = lo + 1; k < hi; k++) {
+            T value = std::move(arr[k]);
+            size_t m = k;
+            while (m > lo && comp(value, arr[m - 1])) {
+                arr[m] = std::move(arr[m - 1]);
+                m--;
+            }
+            arr[m] = std::move(value);
+        }
+    }
+    for (size_t width = block; width < n; width *= 2) {
+        for (size_t a = 0; a + width < n; a += 2 * width) {
+            symMerge(arr, a, a + width, std::min(a + 2 * width, n), comp);
+        }
+    }
+}
+
+/**
+ * @brief Один шаг parallelSampleSort: разбивает [lo, hi) на корзины по разделителям из выборки на месте.
+ * @details 1) Из выборки выбираются до 255 разделителей и раскладываются в неявное дерево поиска
+ *          (нумерация Эйтцингера); корзина элемента вычисляется без ветвлений:
+ *          j = 2j + comp(tree[j], x) на каждом уровне.
+ *          2) Элементы читаются по порядку в буферы корзин по B штук; полный буфер записывается
+ *          блоком на место уже прочитанных элементов, так что за проходом остаются только
+ *          полные блоки в начале диапазона и неполные буферы. При threads > 1 диапазон делится на полосы,
+ *          каждую классифицирует свой поток, затем блоки полос сдвигаются вплотную (последовательно,
+ *          но без сравнений), а остатки буферов сливаются.
+ *          3) Блоки переставляются циклами на места своих корзин, границы которых округлены до B;
+ *          блок, выходящий за конец диапазона, откладывается в отдельный буфер.
+ *          4) Края корзин (до первого и после последнего блока) заполняются из буферов и «свесов»
+ *          соседних блоков. Доп. память — O(корзины × B), а не O(n).
+ * @param threads Количество потоков для классификации.
+ * @return Границы корзин (k + 1 значение) или пустой вектор, если разбиение не уменьшает задачу
+ *         (например, все элементы равны) и диапазон нужно досортировать иначе.
+ */
+template<typename T, typename Compare>
+std::vector<size_t> samplePartition(std::vector<T>& arr, size_t lo, size_t hi, Compare& comp, std::mt19937_64& rng, size_t threads = 1) {
+    const size_t n = hi - lo;
+    const size_t block = std::max<size_t>(8, 2048 / sizeof(T));
+
+    // Разделители по выборке
+    int levels = 1;
+    while (levels < 8 && (n >> (levels + 1)) >= 4 * block) levels++;
+    size_t k = size_t(1) << levels;
+    const size_t oversample = std::max<size_t>(2, static_cast<size_t>(std::log2(static_cast<double>(n)) / 4));
+    std::vector<T> sample;
+    sample.reserve(k * oversample);
+    std::uniform_int_distribution<size_t> pick(lo, hi - 1);
+    for (size_t i = 0; i < k * oversample; i++) sample.push_back(arr[pick(rng)]);
+    std::sort(sample.begin(), sample.end(), comp);
+    std::vector<T> splitters;
+    for (size_t i = 1; i < k; i++) {
+        const T& candidate = sample[i * oversample - 1];
+        if (splitters.empty() || comp(splitters.back(), candidate)) splitters.push_back(candidate);
+    }
+    while (levels > 1 && (size_t(1) << (levels - 1)) > splitters.size()) levels--;
+    k = size_t(1) << levels;
+    while (splitters.size() < k - 1) splitters.push_back(splitters.back());
+
+    std::vector<T> tree(splitters); // tree[0] не используется
+    {
+        size_t next = 0;
+        std::function<void(size_t)> fill = [&](size_t node) {
+            if (node >= k) return;
+            fill(2 * node);
+            tree[node] = splitters[next++];
+            fill(2 * node + 1);
+        };
+        tree.push_back(splitters.back());
+        fill(1);
+    }
+    auto classify = [&](const T& value) {
+        size_t j = 1;
+        for (int l = 0; l < levels; l++) j = 2 * j + static_cast<size_t>(comp(tree[j], value));
+        return j - k;
+    };
+
+    // Классификация в буферы и запись полных блоков в начало своей полосы; полосы — по потоку
+    struct Stripe {
+        size_t write;
+        std::vector<std::vector<T>> buffers;
+        std::vector<size_t> counts;
+    };
+    threads = std::max<size_t>(1, std::min(threads, n / (k * block) + 1));
+    std::vector<Stripe> stripes(threads);
+    parallelFor(threads, [&](size_t t) {
+        Stripe& stripe = stripes[t];
+        stripe.buffers.resize(k);
+        for (auto& buffer : stripe.buffers) buffer.reserve(block);
+        stripe.counts.assign(k, 0);
+        stripe.write = lo + n * t / threads;
+        for (size_t read = stripe.write, end = lo + n * (t + 1) / threads; read < end; read++) {
+            const size_t b = classify(arr[read]);
+            stripe.counts[b]++;
+            stripe.buffers[b].push_back(std::move(arr[read]));
+            if (stripe.buffers[b].size() == block) {
+                std::move(stripe.buffers[b].begin(), stripe.buffers[b].end(), arr.begin() + stripe.write);
+                stripe.buffers[b].clear();
+                stripe.write += block;
+            }
+        }
+    });
+    // Полные блоки полос сдвигаются вплотную, остатки буферов полос сливаются по корзинам
+    std::vector<std::vector<T>> buffers(std::move(stripes[0].buffers));
+    std::vector<size_t> counts(std::move(stripes[0].counts));
+    size_t write = stripes[0].write;
+    for (size_t t = 1; t < threads; t++) {
+        const size_t begin = lo + n * t / threads;
+        std::move(arr.begin() + begin, arr.begin() + stripes[t].write, arr.begin() + write);
+        write += stripes[t].write - begin;
+        for (size_t b = 0; b < k; b++) {
+            counts[b] += stripes[t].counts[b];
+            for (auto& value : stripes[t].buffers[b]) {
+                buffers[b].push_back(std::move(value));
+                if (buffers[b].size() == block) {
+                    std::move(buffers[b].begin(), buffers[b].end(), arr.begin() + write);
+                    buffers[b].clear();
+                    write += block;
+                }
+            }
+        }
+    }
+    for (size_t b = 0; b < k; b++) {
+        if (counts[b] == n) {
+            std::move(buffers[b].begin(), buffers[b].end(), arr.begin() + write);
+            return {};
+        }
+    }
+
+    // Границы корзин и их блоков
+    std::vector<size_t> starts(k + 1), slots(k + 1), full(k);
+    starts[0] = lo;
+    for (size_t b = 0; b < k; b++) {
+        starts[b + 1] = starts[b] + counts[b];
+        full[b] = (counts[b] - buffers[b].size()) / block;
+    }
+    for (size_t b = 0; b <= k; b++) slots[b] = lo + (starts[b] - lo + block - 1) / block * block;
+
+    // Перестановка блоков циклами: [wp, rp] — ещё не разобранные блоки в области корзины
+    std::vector<size_t> wp(k), rp(k);
+    for (size_t b = 0; b < k; b++) {
+        wp[b] = slots[b];
+        const size_t occupied = std::max(slots[b], std::min(slots[b + 1], write));
+        rp[b] = occupied - slots[b];  // количество элементов в занятых блоках области
+    }
+    auto unprocessed = [&](size_t b) { return wp[b] < slots[b] + rp[b]; };
+    auto blockBucket = [&](size_t slot) { return classify(arr[slot]); };
+    std::vector<T> carry, overflow;
+    size_t overflow_bucket = k;
+    for (size_t b = 0; b < k; b++) {
+        while (unprocessed(b)) {
+            size_t c = blockBucket(wp[b]);
+            if (c == b) {
+                wp[b] += block;
+                continue;
+            }
+            carry.assign(std::make_move_iterator(arr.begin() + wp[b]), std::make_move_iterator(arr.begin() + wp[b] + block));
+            while (true) {
+                if (c == b) {
+                    std::move(carry.begin(), carry.end(), arr.begin() + wp[b]);
+                    wp[b] += block;
+                    break;
+                }
+                while (unprocessed(c) && blockBucket(wp[c]) == c) wp[c] += block;
+                if (!unprocessed(c)) {
+                    if (wp[c] + block > hi) {
+                        overflow.swap(carry);
+                        overflow_bucket = c;
+                    } else {
+                        std::move(carry.begin(), carry.end(), arr.begin() + wp[c]);
+                    }
+                    wp[c] += block;
+                    // Цикл закончился в пустом слоте: дыру в корзине b закрывает её последний неразобранный блок
+                    rp[b] -= block;
+                    const size_t last = slots[b] + rp[b];
+                    if (last != wp[b]) std::move(arr.begin() + last, arr.begin() + last + block, arr.begin() + wp[b]);
+                    break;
+                }
+                std::swap_ranges(carry.begin(), carry.end(), arr.begin() + wp[c]);
+                wp[c] += block;
+                c = classify(carry.front());
+            }
+        }
+    }
+
+    // Края корзин: буфер корзины, свес последнего блока в следующую корзину и отложенный блок
+    std::vector<T> pending;
+    for (size_t b = 0; b < k; b++) {
+        const size_t s = starts[b], e = starts[b + 1], d = slots[b], f = slots[b] + full[b] * block;
+        pending.clear();
+        std::move(buffers[b].begin(), buffers[b].end(), std::back_inserter(pending));
+        if (b == overflow_bucket) {
+            const size_t inside = hi - (f - block);
+            std::move(overflow.begin(), overflow.begin() + inside, arr.begin() + (f - block));
+            std::move(overflow.begin() + inside, overflow.end(), std::back_inserter(pending));
+        }
+        if (f > e) {
+            std::move(arr.begin() + e, arr.begin() + std::min(f, hi), std::back_inserter(pending));
+        }
+        size_t next = 0;
+        for (size_t i = s; i < std::min(d, e); i++) arr[i] = std::move(pending[next++]);
+        for (size_t i = std::max(f, s); i < e; i++) arr[i] = std::move(pending[next++]);
+    }
+    return starts;
+}
+
+/**
+ * @brief Параллельная сортировка выборкой на месте в духе IPS4o (In-place Parallel Super Scalar Samplesort).
+ * @details Диапазон разбивается samplePartition на до 256 корзин, корзины сортируются рекурсивно.
+ *          Классификация верхнего уровня идёт параллельно по полосам, корзины верхнего уровня
+ *          распределяются между потоками (самые большие — первыми, каждой нити в наименее
+ *          загруженную очередь), дальше каждая нить рекурсирует сама.
+ *          Небольшие диапазоны, вырожденные разбиения и слишком глубокая рекурсия досортировываются
+ *          std::sort. В отличие от слияния и поразрядной сортировки, O(n) доп. памяти не нужно.
+ * @tparam T Тип элементов в векторе.
+ * @tparam Compare Строгое слабое упорядочение; по умолчанию operator<.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ * @param comp Функция сравнения.
+ */
+template<typename T, typename Compare = std::less<T>>
+void parallelSampleSort(std::vector<T>& arr, Compare comp = Compare()) {
+    const size_t base = 4096;
+    std::function<void(size_t, size_t, int, std::mt19937_64&)> sortRange = [&](size_t lo, size_t hi, int depth, std::mt19937_64& rng) {
+        if (hi - lo <= base || depth == 0) {
+            std::sort(arr.begin() + lo, arr.begin() + hi, comp);
+            return;
+        }
+        const auto bounds = samplePartition(arr, lo, hi, comp, rng);
+        if (bounds.empty()) {
+            std::sort(arr.begin() + lo, arr.begin() + hi, comp);
+            return;
+        }
+        for (size_t b = 0; b + 1 < bounds.size(); b++) {
+            if (bounds[b + 1] - bounds[b] > 1) sortRange(bounds[b], bounds[b + 1], depth - 1, rng);
+        }
+    };
+
+    const size_t n = arr.size();
+    std::mt19937_64 rng(n);
+    const size_t threads = std::min<size_t>(sortThreadCount(), n / std::max<size_t>(g_sortTuning.parallelGrain, 1));
+    if (threads <= 1) {
+        sortRange(0, n, 8, rng);
+        return;
+    }
+    auto bounds = samplePartition(arr, 0, n, comp, rng, threads);
+    if (bounds.empty()) {
+        sortRange(0, n, 0, rng);
+        return;
+    }
+    std::vector<size_t> order(bounds.size() - 1);
+    for (size_t b = 0; b < order.size(); b++) order[b] = b;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return bounds[a + 1] - bounds[a] > bounds[b + 1] - bounds[b];
+    });
+    std::vector<std::vector<size_t>> queues(threads);
+    std::vector<size_t> load(threads, 0);
+    for (size_t b : order) {
+        const size_t t = std::min_element(load.begin(), load.end()) - load.begin();
+        queues[t].push_back(b);
+        load[t] += bounds[b + 1] - bounds[b];
+    }
+    parallelFor(threads, [&](size_t t) {
+        std::mt19937_64 local(n + t);
+        for (size_t b : queues[t]) sortRange(bounds[b], bounds[b + 1], 7, local);
+    });
+}
+
+/**
+ * @brief Сортировка распределением по выборочной функции распределения ключей.
+ * @details По случайной выборке упакованных ключей строится приближённая функция распределения —
+ *          набор разделителей с равным числом элементов выборки между соседними. За один проход
+ *          каждый ключ относится к корзине двоичным поиском по разделителям, затем пары
+ *          (ключ, индекс) раскладываются по корзинам, корзины досортировываются вставками
+ *          (крупные, например из равных ключей, — std::sort), и элементы переставляются за один проход.
+ *          В отличие от flashsort с линейной интерполяцией между минимумом и максимумом,
+ *          выборка учитывает перекос выигрышей: много нулей и мелких сумм, редкие миллионы.
+ * @tparam T LotteryTicket или PackedTicketKey.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ */
+template<typename T>
+void distributionSort(std::vector<T>& arr) {
+    const size_t n = arr.size();
+    if (n <= 2 * g_sortTuning.insertionCutoff || n > UINT32_MAX) {
+        std::sort(arr.begin(), arr.end());
+        return;
+    }
+    struct Item {
+        PackedTicketKey key;
+        uint32_t index;
+    };
+    auto byKey = [](const Item& a, const Item& b) { return a.key < b.key; };
+    std::vector<Item> items(n);
+    for (size_t i = 0; i < n; i++) {
+        items[i] = {packTicketKey(arr[i]), static_cast<uint32_t>(i)};
+    }
+
+    // Около 64 элементов на корзину, не больше 1024 корзин: разделители помещаются в L1,
+    // а большие корзины дешевле досортировать, чем классифицировать двоичным поиском глубже
+    const size_t buckets = std::min<size_t>(1024, std::max<size_t>(2, n / 64));
+    const size_t sample_size = std::min(n, buckets * 4);
+    std::mt19937_64 rng(n);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    std::vector<PackedTicketKey> sample(sample_size);
+    for (auto& key : sample) key = items[pick(rng)].key;
+    std::sort(sample.begin(), sample.end());
+    std::vector<PackedTicketKey> splitters(buckets - 1);
+    for (size_t b = 1; b < buckets; b++) {
+        splitters[b - 1] = sample[b * sample_size / buckets];
+    }
+
+    std::vector<uint32_t> bucket_of(n);
+    std::vector<size_t> offsets(buckets + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+        bucket_of[i] = static_cast<uint32_t>(std::upper_bound(splitters.begin(), splitters.end(), items[i].key) - splitters.begin());
+        offsets[bucket_of[i] + 1]++;
+    }
+    for (size_t b = 0; b < buckets; b++) offsets[b + 1] += offsets[b];
+
+    std::vector<Item> placed(n);
+    {
+        std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < n; i++) placed[next[bucket_of[i]]++] = items[i];
+    }
+    for (size_t b = 0; b < buckets; b++) {
+        const size_t lo = offsets[b], hi = offsets[b + 1];
+        if (hi - lo > 4 * g_sortTuning.insertionCutoff) {
+            std::sort(placed.begin() + lo, placed.begin() + hi, byKey);
+            continue;
+        }
+        for (size_t i = lo + 1; i < hi; i++) {
+            Item value = placed[i];
+            size_t j = i;
+            while (j > lo && byKey(value, placed[j - 1])) {
+                placed[j] = placed[j - 1];
+                j--;
+            }
+            placed[j] = value;
+        }
+    }
+
+    std::vector<T> sorted;
+    sorted.reserve(n);
+    for (const auto& item : placed) sorted.push_back(std::move(arr[item.index]));
+    arr.swap(sorted);
+}
+
+/**
+ * @brief Экспериментальная сортировка по обученной модели функции распределения ключей.
+ * @details Ключ сжимается в 64-битное число: из даты, выигрыша и номера вычитаются минимумы, и поля
+ *          укладываются друг за другом по фактической ширине диапазонов (младшие биты номера при
+ *          нехватке места отбрасываются — модели они не нужны). На выборке строится кусочно-линейная
+ *          модель функции распределения: 1024 отрезка с равным числом точек выборки. За один проход
+ *          модель предсказывает каждому ключу позицию, и пары (ключ, индекс) раскладываются
+ *          в корзины по ~8 элементов вокруг предсказанных позиций. Модель монотонна, поэтому
+ *          порядок между корзинами уже верный, и остаётся локально досортировать каждую корзину.
+ *          Дата принимает мало значений, а выигрыш и номер внутри даты распределены близко
+ *          к равномерному, так что предсказания точные и корзины остаются маленькими.
+ * @tparam T LotteryTicket или PackedTicketKey.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ */
+template<typename T>
+void learnedSort(std::vector<T>& arr) {
+    const size_t n = arr.size();
+    if (n <= 2 * g_sortTuning.insertionCutoff || n > UINT32_MAX) {
+        std::sort(arr.begin(), arr.end());
+        return;
+    }
+    struct Item {
+        PackedTicketKey key;
+        uint32_t index;
+    };
+    auto byKey = [](const Item& a, const Item& b) { return a.key < b.key; };
+    std::vector<Item> items(n);
+    uint64_t min_date = UINT64_MAX, max_date = 0, min_win = UINT64_MAX, max_win = 0, min_number = UINT64_MAX, max_number = 0;
+    for (size_t i = 0; i < n; i++) {
+        items[i] = {packTicketKey(arr[i]), static_cast<uint32_t>(i)};
+        const uint64_t date = items[i].key.hi >> 32, win = items[i].key.hi & 0xFFFFFFFFu, number = items[i].key.lo;
+        min_date = std::min(min_date, date);
+        max_date = std::max(max_date, date);
+        min_win = std::min(min_win, win);
+        max_win = std::max(max_win, win);
+        min_number = std::min(min_number, number);
+        max_number = std::max(max_number, number);
+    }
+
+    // Сжатие ключа в 64 бита с сохранением порядка (без строгости на младших битах номера)
+    auto bitWidth = [](uint64_t range) {
+        int width = 0;
+        while (width < 64 && (range >> width) != 0) width++;
+        return width;
+    };
+    const int date_bits = bitWidth(max_date - min_date), win_bits = bitWidth(max_win - min_win);
+    const int number_bits = bitWidth(max_number - min_number);
+    const int number_keep = std::max(0, std::min(number_bits, 64 - date_bits - win_bits));
+    auto compress = [&](const PackedTicketKey& key) -> double {
+        uint64_t c = (key.hi >> 32) - min_date;
+        if (win_bits > 0) c = (c << win_bits) | ((key.hi & 0xFFFFFFFFu) - min_win);
+        if (number_keep == 64) {
+            // Дата и выигрыш у всех одинаковые (c == 0), а номер занимает все 64 бита: сдвиг на 64 не определён
+            c = key.lo - min_number;
+        } else if (number_keep > 0) {
+            c = (c << number_keep) | ((key.lo - min_number) >> (number_bits - number_keep));
+        }
+        return static_cast<double>(c);
+    };
+
+    // Обучение: кусочно-линейная модель по отсортированной выборке
+    const size_t segments = 1024;
+    const size_t sample_size = std::min(n, std::max<size_t>(segments * 16, n / 100));
+    std::mt19937_64 rng(n);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    std::vector<double> sample(sample_size);
+    for (auto& x : sample) x = compress(items[pick(rng)].key);
+    std::sort(sample.begin(), sample.end());
+    std::vector<double> knots(segments + 1);
+    for (size_t s = 0; s < segments; s++) knots[s] = sample[s * sample_size / segments];
+    knots[segments] = sample.back();
+    auto predict = [&](double x) -> double { // доля элементов меньше x, от 0 до 1
+        size_t s = static_cast<size_t>(std::upper_bound(knots.begin(), knots.end(), x) - knots.begin());
+        if (s == 0) return 0.0;
+        if (s > segments) return 1.0;
+        const double lo = knots[s - 1], hi = knots[s];
+        const double within = hi > lo ? (x - lo) / (hi - lo) : 0.0;
+        return (static_cast<double>(s - 1) + within) / segments;
+    };
+
+    // Размещение: один проход предсказаний, подсчёт и раскладка по корзинам
+    const size_t buckets = std::max<size_t>(1, n / 8);
+    std::vector<uint32_t> bucket_of(n);
+    std::vector<size_t> offsets(buckets + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+        size_t b = static_cast<size_t>(predict(compress(items[i].key)) * buckets);
+        bucket_of[i] = static_cast<uint32_t>(std::min(b, buckets - 1));
+        offsets[bucket_of[i] + 1]++;
+    }
+    for (size_t b = 0; b < buckets; b++) offsets[b + 1] += offsets[b];
+    std::vector<Item> placed(n);
+    {
+        std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < n; i++) placed[next[bucket_of[i]]++] = items[i];
+    }
+
+    // Локальная досортировка
+    for (size_t b = 0; b < buckets; b++) {
+        const size_t lo = offsets[b], hi = offsets[b + 1];
+        if (hi - lo > 4 * g_sortTuning.insertionCutoff) {
+            std::sort(placed.begin() + lo, placed.begin() + hi, byKey);
+            continue;
+        }
+        for (size_t i = lo + 1; i < hi; i++) {
+            Item value = placed[i];
+            size_t j = i;
+            while (j > lo && byKey(value, placed[j - 1])) {
+                placed[j] = placed[j - 1];
+                j--;
+            }
+            placed[j] = value;
+        }
+    }
+
+    std::vector<T> sorted;
+    sorted.reserve(n);
+    for (const auto& item : placed) sorted.push_back(std::move(arr[item.index]));
+    arr.swap(sorted);
+}
+
+/**
+ * @brief Поразрядная сортировка (LSD) пар (64-битный ключ, индекс) по ключу.
+ * @details Разряды, одинаковые у всех ключей, пропускаются. Ширина разряда — g_sortTuning.radixDigitBits.
+ * @param items Пары для сортировки. Сортируются на месте, порядок равных ключей сохраняется.
+ */
+void radixSortPairs64(std::vector<std::pair<uint64_t, uint32_t>>& items) {
+    const size_t n = items.size();
+    if (n < 2) return;
+    const int bits = std::min(16, std::max(4, g_sortTuning.radixDigitBits));
+    const int digits = (64 + bits - 1) / bits;
+    const size_t radix = size_t(1) << bits;
+    auto digitOf = [&](uint64_t key, int d) { return static_cast<size_t>(key >> (d * bits)) & (radix - 1); };
+
+    std::vector<size_t> counts(static_cast<size_t>(digits) * radix, 0);
+    for (const auto& item : items) {
+        for (int d = 0; d < digits; d++) counts[d * radix + digitOf(item.first, d)]++;
+    }
+    std::vector<std::pair<uint64_t, uint32_t>> buffer(n);
+    for (int d = 0; d < digits; d++) {
+        size_t* count = &counts[d * radix];
+        if (count[digitOf(items[0].first, d)] == n) continue;
+        size_t offset = 0;
+        for (size_t b = 0; b < radix; b++) {
+            size_t c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (const auto& item : items) buffer[count[digitOf(item.first, d)]++] = item;
+        items.swap(buffer);
+    }
+}
+
+/**
+ * @brief Проверяет, что билет без выигрыша.
+ * @param key Упакованный ключ билета.
+ */
+bool isZeroWin(const PackedTicketKey& key) {
+    return static_cast<uint32_t>(key.hi) == static_cast<uint32_t>(~0x80000000u);
+}
+
+/** @brief Перегрузка для билета: не требует упаковки ключа. */
+bool isZeroWin(const LotteryTicket& ticket) { return ticket.winAmount == 0; }
+
+/**
+ * @brief Сортировка с отделением билетов без выигрыша.
+ * @details В порядке operator< билеты с winAmount == 0 образуют хвост группы каждой даты
+ *          и упорядочены только по номеру. За один проход (std::partition) они отделяются от выигрышных и
+ *          сортируются поразрядно по 64-битному ключу (дата, номер); полное сравнение
+ *          выполняется только для выигрышных билетов. Затем обе части сливаются.
+ *          Если диапазоны дат и номеров не помещаются в 64 бита, хвост сортируется сравнением пар (дата, номер).
+ * @tparam T LotteryTicket или PackedTicketKey.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ */
+template<typename T>
+void zeroWinSplitSort(std::vector<T>& arr) {
+    const size_t n = arr.size();
+    if (n < 2 || n > UINT32_MAX) {
+        std::sort(arr.begin(), arr.end());
+        return;
+    }
+    auto zeros_begin = std::partition(arr.begin(), arr.end(), [](const T& item) { return !isZeroWin(item); });
+    std::sort(arr.begin(), zeros_begin);
+
+    const size_t first_zero = static_cast<size_t>(zeros_begin - arr.begin());
+    const size_t zero_count = n - first_zero;
+    std::vector<std::pair<uint64_t, uint64_t>> fields(zero_count); // (дата, номер) из упакованного ключа
+    uint64_t min_date = UINT64_MAX, max_date = 0, min_number = UINT64_MAX, max_number = 0;
+    for (size_t z = 0; z < zero_count; z++) {
+        PackedTicketKey key = packTicketKey(arr[first_zero + z]);
+        fields[z] = {key.hi >> 32, key.lo};
+        min_date = std::min(min_date, fields[z].first);
+        max_date = std::max(max_date, fields[z].first);
+        min_number = std::min(min_number, key.lo);
+        max_number = std::max(max_number, key.lo);
+    }
+    auto bitWidth = [](uint64_t range) {
+        int width = 0;
+        while (width < 64 && (range >> width) != 0) width++;
+        return width;
+    };
+    const int number_bits = zero_count == 0 ? 0 : bitWidth(max_number - min_number);
+    std::vector<std::pair<uint64_t, uint32_t>> order(zero_count);
+    if (zero_count == 0 || number_bits + bitWidth(max_date - min_date) <= 64) {
+        for (size_t z = 0; z < zero_count; z++) {
+            const uint64_t number = fields[z].second - min_number;
+            const uint64_t date = fields[z].first - min_date;
+            order[z] = {number_bits == 64 ? number : (date << number_bits) | number, static_cast<uint32_t>(z)};
+        }
+        radixSortPairs64(order);
+    } else {
+        for (size_t z = 0; z < zero_count; z++) order[z] = {0, static_cast<uint32_t>(z)};
+        std::sort(order.begin(), order.end(), [&](const auto& a, const auto& b) {
+            return fields[a.second] < fields[b.second];
+        });
+    }
+
+    // Слияние: выигрышный билет идёт раньше билета без выигрыша той же даты
+    std::vector<T> result;
+    result.reserve(n);
+    size_t w = 0;
+    for (const auto& entry : order) {
+        T& zero = arr[first_zero + entry.second];
+        while (w < first_zero && arr[w] < zero) result.push_back(std::move(arr[w++]));
+        result.push_back(std::move(zero));
+    }
+    while (w < first_zero) result.push_back(std::move(arr[w++]));
+    arr.swap(result);
+}
+
+// --- Адаптивный выбор алгоритма ---
+
+/**
+ * @struct SortProfile
+ * @brief Оценка характеристик входа по небольшой выборке.
+ */
+struct SortProfile {
+    size_t size = 0;             ///< Количество элементов.
+    size_t estimatedRuns = 0;    ///< Оценка количества упорядоченных (по возрастанию или убыванию) участков.
+    size_t distinctDates = 0;    ///< Количество различных дат в выборке.
+    double duplicateRate = 0;    ///< Доля элементов выборки, ключ которых совпал с другим элементом выборки.
+    double zeroWinRate = 0;      ///< Доля билетов без выигрыша в выборке.
+    unsigned cores = 1;          ///< Доступное количество потоков.
+};
+
+/**
+ * @brief Оценивает характеристики входа по случайной выборке.
+ * @details Упорядоченность оценивается по доле убываний среди случайных соседних пар,
+ *          даты и повторы ключей — по случайной выборке элементов. Стоимость O(sample).
+ * @tparam T Тип элементов с перегрузкой packTicketKey.
+ * @param arr Входные данные.
+ * @param sample Размер выборки.
+ * @return Профиль входа.
+ */
+template<typename T>
+SortProfile profileTickets(const std::vector<T>& arr, size_t sample = 512) {
+    SortProfile profile;
+    profile.size = arr.size();
+    profile.cores = sortThreadCount();
+    if (arr.size() < 2) {
+        profile.estimatedRuns = arr.size();
+        profile.distinctDates = arr.size();
+        return profile;
+    }
+    std::mt19937_64 rng(arr.size());
+    std::uniform_int_distribution<size_t> pick(0, arr.size() - 2);
+    const size_t probes = std::min(sample, arr.size() - 1);
+    size_t descents = 0;
+    std::vector<PackedTicketKey> keys;
+    std::set<uint64_t> dates;
+    std::set<size_t> picked;
+    for (size_t k = 0; k < probes; k++) {
+        size_t i = probes == arr.size() - 1 ? k : pick(rng);
+        if (arr[i + 1] < arr[i]) descents++;
+        if (!picked.insert(i).second) continue; // повтор индекса дал бы ложный дубликат ключа
+        keys.push_back(packTicketKey(arr[i]));
+        dates.insert(keys.back().hi >> 32);
+    }
+    // Убывающие участки naturalMergeSort разворачивает, поэтому почти обратный порядок тоже "почти упорядочен"
+    const size_t breaks = std::min(descents, probes - descents);
+    profile.estimatedRuns = 1 + static_cast<size_t>(static_cast<double>(breaks) / probes * (arr.size() - 1));
+    profile.distinctDates = dates.size();
+    profile.zeroWinRate = static_cast<double>(std::count_if(keys.begin(), keys.end(),
+        [](const PackedTicketKey& key) { return isZeroWin(key); })) / keys.size();
+    std::sort(keys.begin(), keys.end());
+    size_t duplicates = 0;
+    for (size_t k = 0; k < keys.size(); k++) {
+        bool same_prev = k > 0 && keys[k] == keys[k - 1];
+        bool same_next = k + 1 < keys.size() && keys[k] == keys[k + 1];
+        if (same_prev || same_next) duplicates++;
+    }
+    profile.duplicateRate = static_cast<double>(duplicates) / keys.size();
+    return profile;
+}
+
+/**
+ * @struct SortDecision
+ * @brief Выбор адаптивной сортировки и его причина.
+ */
+struct SortDecision {
+    std::string engine;  ///< Выбранный алгоритм.
+    std::string reason;  ///< Почему выбран именно он.
+    SortProfile profile; ///< Профиль, по которому принималось решение.
+};
+
+/**
+ * @brief Выбирает алгоритм по профилю входа.
+ * @param profile Профиль входа.
+ * @return Решение без выполнения сортировки.
+ */
+SortDecision chooseSortEngine(const SortProfile& profile) {
+    const size_t n = profile.size;
+    if (n <= g_sortTuning.insertionCutoff) {
+        return {"insertionSort", "tiny input", profile};
+    }
+    if (profile.estimatedRuns <= std::max<size_t>(2, n / 256)) {
+        return {"naturalMergeSort", "input is nearly sorted", profile};
+    }
+    if (profile.cores > 1 && n >= 2 * g_sortTuning.parallelGrain) {
+        return {"parallelSort", "large input and " + std::to_string(profile.cores) + " cores", profile};
+    }
+    if (profile.zeroWinRate >= 0.8) {
+        return {"zeroWinSplitSort", "mostly zero-win tickets", profile};
+    }
+    if (n >= g_sortTuning.radixMinSize) {
+        return {"radixSort", "large random input, fixed-width key", profile};
+    }
+    if (profile.duplicateRate >= 0.2) {
+        return {"quickSort3Way", "many duplicate keys", profile};
+    }
+    if (profile.zeroWinRate >= 0.3) {
+        return {"zeroWinSplitSort", "many zero-win tickets", profile};
+    }
+    return {"std::sort", "medium random input", profile};
+}
+
+/**
+ * @brief Сортирует билеты алгоритмом, выбранным по характеристикам входа.
+ * @details Точка входа для вызывающего кода: вместо выбора между std::sort, heapSort и
+ *          остальными вручную достаточно вызвать sortTickets. Решение пишется в log.
+ * @tparam T LotteryTicket или PackedTicketKey.
+ * @param arr Вектор элементов для сортировки. Сортируется на месте.
+ * @param log Поток для записи решения или nullptr.
+ * @return Принятое решение.
+ */
+template<typename T>
+SortDecision sortTickets(std::vector<T>& arr, std::ostream* log = &std::clog) {
+    SortDecision decision = chooseSortEngine(profileTickets(arr));
+    if (log != nullptr) {
+        const SortProfile& p = decision.profile;
+        *log << "sortTickets: n=" << p.size << " runs~" << p.estimatedRuns << " dates~" << p.distinctDates
+             << " dup=" << std::fixed << std::setprecision(1) << 100.0 * p.duplicateRate << "%"
+             << " zero-win=" << 100.0 * p.zeroWinRate << "% cores=" << p.cores
+             << " -> " << decision.engine << " (" << decision.reason << ")" << std::endl;
+    }
+    TraceSpan span("sortTickets", decision.engine + " " + std::to_string(arr.size()));
+    if (decision.engine == "insertionSort") {
+        insertionSort(arr);
+    } else if (decision.engine == "naturalMergeSort") {
+        naturalMergeSort(arr);
+    } else if (decision.engine == "parallelSort") {
+        parallelSort(arr);
+    } else if (decision.engine == "radixSort") {
+        radixSort(arr);
+    } else if (decision.engine == "zeroWinSplitSort") {
+        zeroWinSplitSort(arr);
+    } else if (decision.engine == "quickSort3Way") {
+        quickSort3Way(arr);
+    } else {
+        std::sort(arr.begin(), arr.end());
+    }
+    return decision;
+}
+
+// --- Реестр алгоритмов ---
+
+/**
+ * @struct SortEngine
+ * @brief Алгоритм сортировки, доступный режимам массового сравнения.
+ * @tparam T Тип сортируемых элементов.
+ */
+template<typename T>
+struct SortEngine {
+    std::string name;                          ///< Имя алгоритма в отчётах.
+    std::function<void(std::vector<T>&)> sort; ///< Сортировка вектора на месте.
+    bool quadratic;                            ///< true для O(n²)-алгоритмов, которые пропускаются на больших n.
+};
+
+/**
+ * @brief Возвращает список алгоритмов сортировки для типа T.
+ * @tparam T Тип элементов. Должен поддерживать операторы '<' и '>'.
+ * @return Алгоритмы в порядке вывода в отчётах.
+ */
+template<typename T>
+std::vector<SortEngine<T>> sortEngines() {
+    return {
+        {"std::sort", [](std::vector<T>& arr) { std::sort(arr.begin(), arr.end()); }, false},
+        {"bubbleSort", [](std::vector<T>& arr) { bubbleSort(arr); }, true},
+        {"selectionSort", [](std::vector<T>& arr) { selectionSort(arr); }, true},
+        {"heapSort", [](std::vector<T>& arr) { heapSort(arr); }, false},
+        {"smoothSort", [](std::vector<T>& arr) { smoothSort(arr); }, false},
+        {"insertionSort", [](std::vector<T>& arr) { insertionSort(arr); }, true},
+        {"radixSort", [](std::vector<T>& arr) { radixSort(arr); }, false},
+        {"americanFlagSort", [](std::vector<T>& arr) { americanFlagSort(arr); }, false},
+        {"naturalMergeSort", [](std::vector<T>& arr) { naturalMergeSort(arr); }, false},
+        {"parallelSort", [](std::vector<T>& arr) { parallelSort(arr); }, false},
+        {"numaSort", [](std::vector<T>& arr) { numaSort(arr); }, false},
+        {"dAryHeapSort", [](std::vector<T>& arr) { dAryHeapSort(arr); }, false},
+        {"progressiveSort", [](std::vector<T>& arr) { progressiveSort(arr, [](const T&) {}); }, false},
+        {"zeroWinSplitSort", [](std::vector<T>& arr) { zeroWinSplitSort(arr); }, false},
+        {"quickSort3Way", [](std::vector<T>& arr) { quickSort3Way(arr); }, false},
+        {"blockMergeSort", [](std::vector<T>& arr) { blockMergeSort(arr); }, false},
+        {"parallelSampleSort", [](std::vector<T>& arr) { parallelSampleSort(arr); }, false},
+        {"distributionSort", [](std::vector<T>& arr) { distributionSort(arr); }, false},
+        {"learnedSort", [](std::vector<T>& arr) { learnedSort(arr); }, false},
+        {"sortTickets", [](std::vector<T>& arr) { sortTickets(arr, nullptr); }, false},
+    };
+}
+
+/**
+ * @brief Разбирает строку "номер,стоимость,дата,выигрыш".
+ * @param line Строка файла.
+ * @return Билет.
+ */
+LotteryTicket parseTicketLine(const std::string& line) {
+    std::stringstream ss(line);
+    std::string item;
+    long long num;
+    int cost, win;
+    std::string date;
+
+    std::getline(ss, item, ','); num = std::stoll(item);
+    std::getline(ss, item, ','); cost = std::stoi(item);
+    std::getline(ss, item, ','); date = item;
+    std::getline(ss, item, ','); win = std::stoi(item);
+
+    return LotteryTicket(num, cost, date, win);
+}
+
+/**
+ * @brief Считывает данные о лотерейных билетах из файла.
+ * @param filename Имя файла для чтения.
+ * @return Вектор объектов LotteryTicket, прочитанных из файла.
+ * @throws std::runtime_error Если не удалось открыть файл.
+ */
+std::vector<LotteryTicket> readTicketsFromFile(const std::string& filename) {
+    TraceSpan span("parse", filename);
+    std::vector<LotteryTicket> tickets;
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        tickets.push_back(parseTicketLine(line));
+    }
+    return tickets;
+}
+
+/**
+ * @brief Записывает данные о лотерейных билетах в файл.
+ * @param filename Имя файла для записи.
+ * @param tickets Вектор объектов LotteryTicket для записи.
+ * @throws std::runtime_error Если не удалось открыть файл для записи.
+ */
+void writeTicketsToFile(const std::string& filename, const std::vector<LotteryTicket>& tickets) {
+    TraceSpan span("write output", filename);
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file for writing: " + filename);
+    }
+    for (const auto& ticket : tickets) {
+        file << ticket << "\n";
+    }
+}
+
+/**
+ * @brief Копирует набор данных перед очередным замером.
+ * @details Выделено в отдельную функцию, чтобы копирование было видно в трассе отдельным этапом.
+ * @param tickets Исходный набор билетов.
+ * @return Копия набора.
+ */
+std::vector<LotteryTicket> copyTickets(const std::vector<LotteryTicket>& tickets) {
+    TraceSpan span("copy dataset", std::to_string(tickets.size()));
+    return tickets;
+}
+
+/**
+ * @brief Проверяет, что билеты упорядочены по operator<.
+ * @param tickets Отсортированный вектор билетов.
+ * @param algorithm Имя алгоритма для сообщения об ошибке.
+ * @throws std::runtime_error Если порядок нарушен.
+ */
+void verifySorted(const std::vector<LotteryTicket>& tickets, const std::string& algorithm) {
+    TraceSpan span("verify", algorithm);
+    if (!std::is_sorted(tickets.begin(), tickets.end())) {
+        throw std::runtime_error("Result of " + algorithm + " is not sorted (n = " + std::to_string(tickets.size()) + ")");
+    }
+}
+
+// --- Синтетические данные ---
+
+/**
+ * @brief Генерирует билеты с распределением, похожим на файлы lottery_N.txt.
+ * @details Еженедельные розыгрыши с 2025-01-05, стоимость 100/150/200, по умолчанию около трети
+ *          билетов без выигрыша, остальные выигрыши логнормальные (медиана ~270)
+ *          с редкими крупными призами, номера — равномерные 10-значные.
+ * @param n Количество билетов.
+ * @param seed Зерно генератора.
+ * @param draws Количество различных дат розыгрыша.
+ * @param zero_share Доля билетов без выигрыша.
+ * @return Вектор билетов в случайном порядке.
+ */
+std::vector<LotteryTicket> generateTickets(size_t n, unsigned seed, int draws = 17, double zero_share = 0.34) {
+    std::mt19937_64 rng(seed);
+    std::vector<std::string> dates;
+    const int first_draw = daysFromCivil(2025, 1, 5);
+    for (int i = 0; i < draws; i++) {
+        dates.push_back(formatDateDays(first_draw + 7 * i));
+    }
+    std::uniform_int_distribution<int> date_dist(0, draws - 1);
+    std::uniform_int_distribution<int> cost_dist(0, 2);
+    std::uniform_int_distribution<long long> number_dist(0, 9999999999LL);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::lognormal_distribution<double> small_win(5.6, 0.9);
+    std::uniform_int_distribution<int> big_win(100000, 5000000);
+
+    std::vector<LotteryTicket> tickets;
+    tickets.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        double p = unit(rng);
+        int win = p < zero_share ? 0 : (p < 0.999 ? 1 + static_cast<int>(small_win(rng)) : big_win(rng));
+        tickets.emplace_back(number_dist(rng), 100 + 50 * cost_dist(rng), dates[date_dist(rng)], win);
+    }
+    return tickets;
+}
+
+/**
+ * @brief Генерирует билеты с большим количеством повторяющихся ключей.
+ * @details Выигрыши берутся из нескольких призовых уровней, номера — из небольшого пула,
+ *          поэтому много билетов совпадают и по (дате, выигрышу), и по полному ключу.
+ * @param n Количество билетов.
+ * @param seed Зерно генератора.
+ * @param distinct_numbers Размер пула номеров.
+ * @return Вектор билетов в случайном порядке.
+ */
+std::vector<LotteryTicket> generateDuplicateHeavyTickets(size_t n, unsigned seed, long long distinct_numbers = 100) {
+    std::mt19937_64 rng(seed);
+    const int tiers[] = {0, 0, 0, 50, 50, 100, 100, 500, 1000, 10000, 1000000};
+    const int tier_count = sizeof(tiers) / sizeof(tiers[0]);
+    std::vector<std::string> dates;
+    const int first_draw = daysFromCivil(2025, 1, 5);
+    for (int i = 0; i < 4; i++) {
+        dates.push_back(formatDateDays(first_draw + 7 * i));
+    }
+    std::uniform_int_distribution<int> date_dist(0, 3);
+    std::uniform_int_distribution<int> tier_dist(0, tier_count - 1);
+    std::uniform_int_distribution<long long> number_dist(0, std::max(1LL, distinct_numbers) - 1);
+    std::vector<LotteryTicket> tickets;
+    tickets.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        tickets.emplace_back(1000000000LL + number_dist(rng), 100, dates[date_dist(rng)], tiers[tier_dist(rng)]);
+    }
+    return tickets;
+}
+
+/**
+ * @brief Генерирует билеты с выигрышами по закону Ципфа.
+ * @details Выигрыш = 50 * (ранг - 1), где ранг от 1 до 100 000 выбирается с вероятностью ~ 1 / ранг^s:
+ *          больше всего нулей и мелких выигрышей, изредка — миллионы.
+ * @param n Количество билетов.
+ * @param seed Зерно генератора.
+ * @param s Показатель распределения Ципфа.
+ * @return Вектор билетов в случайном порядке.
+ */
+std::vector<LotteryTicket> generateZipfTickets(size_t n, unsigned seed, double s = 1.2) {
+    const int ranks = 100000;
+    std::vector<double> cdf(ranks);
+    double total = 0;
+    for (int r = 1; r <= ranks; r++) {
+        total += 1.0 / std::pow(r, s);
+        cdf[r - 1] = total;
+    }
+    std::vector<LotteryTicket> tickets = generateTickets(n, seed);
+    std::mt19937_64 rng(seed + 1);
+    std::uniform_real_distribution<double> unit(0.0, total);
+    for (auto& ticket : tickets) {
+        const int rank = static_cast<int>(std::lower_bound(cdf.begin(), cdf.end(), unit(rng)) - cdf.begin());
+        ticket.winAmount = 50 * std::min(rank, ranks - 1);
+    }
+    return tickets;
+}
+
+/**
+ * @brief Упаковывает ключи всех билетов.
+ * @param tickets Билеты.
+ * @return Вектор ключей в том же порядке.
+ */
+std::vector<PackedTicketKey> packTicketKeys(const std::vector<LotteryTicket>& tickets) {
+    std::vector<PackedTicketKey> keys;
+    keys.reserve(tickets.size());
+    for (const auto& ticket : tickets) {
+        keys.push_back(packTicketKey(ticket));
+    }
+    return keys;
+}
+
+/**
+ * @brief Измеряет время сортировки в наносекундах на элемент.
+ * @details Сортирует копии data, пока суммарное время не превысит min_total_ms
+ *          (но не меньше min_runs и не больше max_runs раз). Копирование в замер не входит.
+ * @tparam T Тип элементов.
+ * @param engine Алгоритм.
+ * @param data Исходные данные.
+ * @param min_total_ms Минимальное суммарное время замеров.
+ * @param min_runs Минимальное количество запусков.
+ * @param max_runs Максимальное количество запусков.
+ * @return Медиана времени на элемент, нс.
+ */
+template<typename T>
+double measureNsPerElement(const SortEngine<T>& engine, const std::vector<T>& data,
+                           double min_total_ms = 200.0, int min_runs = 3, int max_runs = 100) {
+    std::vector<double> samples;
+    double total_ns = 0;
+    while (static_cast<int>(samples.size()) < min_runs ||
+           (total_ns < min_total_ms * 1e6 && static_cast<int>(samples.size()) < max_runs)) {
+        std::vector<T> copy = data;
+        auto start = std::chrono::steady_clock::now();
+        engine.sort(copy);
+        auto end = std::chrono::steady_clock::now();
+        double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        samples.push_back(ns);
+        total_ns += ns;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2] / std::max<size_t>(data.size(), 1);
+}
+
+/**
+ * @brief Запускает и измеряет время выполнения std::sort, выводит результат в консоль и в файл.
+ * @param tickets Вектор лотерейных билетов для сортировки. Передается по значению.
+ */
+void benchmarkStdSort(std::vector<LotteryTicket> tickets) {
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        TraceSpan span("sort", "std::sort " + std::to_string(tickets.size()));
+        std::sort(tickets.begin(), tickets.end());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    
+    std::cout << "Algorithm: std::sort"
+              << ", Time: " << duration.count() << " ms" << std::endl;
+    
+    std::string output_filename = "sorted_std_sort_" + std::to_string(tickets.size()) + ".csv";
+    writeTicketsToFile(output_filename, tickets);
+}
+
+/**
+ * @brief Измеряет время выполнения std::sort.
+ * @param tickets Вектор лотерейных билетов для сортировки. Передается по значению.
+ * @return Время выполнения сортировки в миллисекундах.
+ */
+long long measureStdSort(std::vector<LotteryTicket> tickets) {
+    TraceSpan span("measureStdSort", std::to_string(tickets.size()));
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        TraceSpan sort_span("sort", "std::sort " + std::to_string(tickets.size()));
+        std::sort(tickets.begin(), tickets.end());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    verifySorted(tickets, "std::sort");
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+}
+
+/**
+ * @brief Измеряет время выполнения сортировки выбором и записывает результат в файл.
+ * @param tickets Вектор лотерейных билетов для сортировки. Передается по значению.
+ * @return Время выполнения сортировки в миллисекундах.
+ */
+long long measureSelectionSort(std::vector<LotteryTicket> tickets) {
+    TraceSpan span("measureSelectionSort", std::to_string(tickets.size()));
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        TraceSpan sort_span("sort", "selectionSort " + std::to_string(tickets.size()));
+        selectionSort(tickets);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    verifySorted(tickets, "selectionSort");
+    writeTicketsToFile("lottery_selection_sort_" + std::to_string(tickets.size()), tickets);
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+}
+
+/**
+ * @brief Измеряет время выполнения пузырьковой сортировки и записывает результат в файл.
+ * @param tickets Вектор лотерейных билетов для сортировки. Передается по значению.
+ * @return Время выполнения сортировки в миллисекундах.
+ */
+long long measureBubbleSort(std::vector<LotteryTicket> tickets) {
+    TraceSpan span("measureBubbleSort", std::to_string(tickets.size()));
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        TraceSpan sort_span("sort", "bubbleSort " + std::to_string(tickets.size()));
+        bubbleSort(tickets);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    verifySorted(tickets, "bubbleSort");
+    writeTicketsToFile("lottery_bubble_sort_" + std::to_string(tickets.size()), tickets);
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+}
+
+/**
+ * @brief Измеряет время выполнения пирамидальной сортировки и записывает результат в файл.
+ * @param tickets Вектор лотерейных билетов для сортировки. Передается по значению.
+ * @return Время выполнения сортировки в миллисекундах.
+ */
+long long measureHeapSort(std::vector<LotteryTicket> tickets) {
+    TraceSpan span("measureHeapSort", std::to_string(tickets.size()));
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        TraceSpan sort_span("sort", "heapSort " + std::to_string(tickets.size()));
+        heapSort(tickets);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    verifySorted(tickets, "heapSort");
+    writeTicketsToFile("lottery_heap_sort_" + std::to_string(tickets.size()), tickets);
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+}
+
+// --- Командная строка ---
+
+/**
+ * @struct CommandLine
+ * @brief Разобранные аргументы командной строки.
+ * @details Аргументы вида `--ключ=значение` и `--флаг` попадают в options,
+ *          остальные — в positional в порядке следования.
+ */
+struct CommandLine {
+    std::vector<std::string> positional;        ///< Позиционные аргументы.
+    std::map<std::string, std::string> options; ///< Опции без префикса "--".
+
+    /** @brief Проверяет, задана ли опция. */
+    bool has(const std::string& key) const { return options.count(key) != 0; }
+
+    /**
+     * @brief Возвращает значение опции.
+     * @param key Имя опции.
+     * @param fallback Значение по умолчанию, если опция не задана или задана без значения.
+     */
+    std::string get(const std::string& key, const std::string& fallback) const {
+        auto it = options.find(key);
+        return (it == options.end() || it->second.empty()) ? fallback : it->second;
+    }
+
+    /**
+     * @brief Возвращает целочисленное значение опции.
+     * @param key Имя опции.
+     * @param fallback Значение по умолчанию.
+     * @throws std::runtime_error Если значение не является числом.
+     */
+    long long getInt(const std::string& key, long long fallback) const {
+        std::string value = get(key, "");
+        if (value.empty()) return fallback;
+        try {
+            return std::stoll(value);
+        } catch (const std::exception&) {
+            throw std::runtime_error("Option --" + key + " expects a number, got: " + value);
+        }
+    }
+
+    /**
+     * @brief Возвращает список чисел из опции вида `--ключ=1,2,3`.
+     * @param key Имя опции.
+     * @param fallback Значение по умолчанию.
+     * @throws std::runtime_error Если элемент списка не является числом.
+     */
+    std::vector<long long> getIntList(const std::string& key, const std::vector<long long>& fallback) const {
+        std::string value = get(key, "");
+        if (value.empty()) return fallback;
+        std::vector<long long> result;
+        std::stringstream ss(value);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            try {
+                result.push_back(std::stoll(item));
+            } catch (const std::exception&) {
+                throw std::runtime_error("Option --" + key + " expects a list of numbers, got: " + value);
+            }
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief Разбирает аргументы командной строки.
+ * @param argc Количество аргументов.
+ * @param argv Массив аргументов.
+ * @return Разобранные аргументы.
+ */
+CommandLine parseCommandLine(int argc, char* argv[]) {
+    CommandLine cmd;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) {
+            auto eq = arg.find('=');
+            if (eq == std::string::npos) {
+                cmd.options[arg.substr(2)] = "";
+            } else {
+                cmd.options[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+            }
+        } else {
+            cmd.positional.push_back(arg);
+        }
+    }
+    return cmd;
+}
+
+/**
+ * @brief Основной сравнительный замер четырех алгоритмов на файлах lottery_N.txt.
+ * @details Функция выполняет следующие шаги:
+ * 1. Определяет размеры наборов данных для тестирования.
+ * 2. Читает данные о лотерейных билетах из соответствующих файлов.
+ * 3. Запускает замеры времени для четырех алгоритмов сортировки (std::sort, Bubble, Selection, Heap) на каждом наборе данных.
+ * 4. Записывает результаты замеров (размер массива и время для каждого алгоритма) в файл "time_sorts.txt".
+ *
+ * Опция `--quadratic-limit=N` пропускает пузырьковую сортировку и сортировку выбором на наборах
+ * больше N элементов: вместо времени записывается -1, а оценку даёт complexity_fit.py.
+ * @param cmd Аргументы командной строки.
+ */
+void runBenchmark(const CommandLine& cmd) {
+    std::vector<std::string> filenames;
+    std::vector<int> arr_size = {100, 500, 1000, 2500, 5000, 7500, 10000, 12500, 15000, 20000, 30000, 40000, 50000, 60000, 80000, 100000};
+
+    // Загрузка данных
+    std::vector<std::vector<LotteryTicket>> arrs_tickets;
+    for(auto el: arr_size){
+        filenames.push_back("lottery_" + std::to_string(el) + ".txt");
+    }
+
+    {
+        TraceSpan span("load datasets");
+        for(const auto& name: filenames){
+            arrs_tickets.push_back(readTicketsFromFile(name));
+        }
+    }
+
+    // Замеры скорости 
+    const long long quadratic_limit = cmd.getInt("quadratic-limit", -1);
+    auto skipQuadratic = [&](const std::vector<LotteryTicket>& arr) {
+        return quadratic_limit >= 0 && static_cast<long long>(arr.size()) > quadratic_limit;
+    };
+
+    std::vector<long long> std_sort_times;
+    for(const auto& arr : arrs_tickets){
+        std_sort_times.push_back(measureStdSort(copyTickets(arr)));
+    }
+
+    std::vector<long long> std_bubble_times;
+    for(const auto& arr : arrs_tickets){
+        std_bubble_times.push_back(skipQuadratic(arr) ? -1 : measureBubbleSort(copyTickets(arr)));
+    }
+
+    std::vector<long long> std_selection_times;
+    for(const auto& arr : arrs_tickets){
+        std_selection_times.push_back(skipQuadratic(arr) ? -1 : measureSelectionSort(copyTickets(arr)));
+    }
+
+    std::vector<long long> std_heap_times;
+    for(const auto& arr : arrs_tickets){
+        std_heap_times.push_back(measureHeapSort(copyTickets(arr)));
     }
 
     // записываем результаты замеров в файл
+    TraceSpan span("write results", "time_sorts.txt");
     std::ofstream out;          // поток для записи
     out.open("time_sorts.txt");
     for(int i = 0; i < std_sort_times.size(); i++){
         out << arr_size[i] << '\t' << std_sort_times[i] << '\t' << std_bubble_times[i] << '\t' << std_selection_times[i] << '\t' << std_heap_times[i] << std::endl;
     }
-    out.close(); 
+    out.close(); 
+}
+
+// --- Иерархия кэшей ---
+
+/**
+ * @struct CacheLevel
+ * @brief Уровень кэша данных процессора.
+ */
+struct CacheLevel {
+    int level;        ///< Номер уровня (1, 2, 3...).
+    size_t sizeBytes; ///< Размер в байтах.
+};
+
+/**
+ * @brief Разбирает размер кэша в формате sysfs ("48K", "2048K", "32M").
+ * @param text Строка с размером.
+ * @return Размер в байтах или 0, если строку разобрать не удалось.
+ */
+size_t parseCacheSize(const std::string& text) {
+    size_t pos = 0;
+    unsigned long long value = 0;
+    try {
+        value = std::stoull(text, &pos);
+    } catch (const std::exception&) {
+        return 0;
+    }
+    char suffix = pos < text.size() ? text[pos] : ' ';
+    if (suffix == 'K' || suffix == 'k') value <<= 10;
+    if (suffix == 'M' || suffix == 'm') value <<= 20;
+    if (suffix == 'G' || suffix == 'g') value <<= 30;
+    return static_cast<size_t>(value);
+}
+
+/**
+ * @brief Определяет размеры кэшей данных первого ядра.
+ * @details На Linux читает /sys/devices/system/cpu/cpu0/cache/index*, на macOS — sysctl hw.l*cachesize.
+ *          Если ничего не удалось прочитать, возвращает типичные значения и сообщает об этом.
+ * @return Уровни кэша по возрастанию номера, по одному на уровень.
+ */
+std::vector<CacheLevel> detectCacheLevels() {
+    std::map<int, size_t> sizes;
+    for (int index = 0; index < 16; index++) {
+        std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+        std::ifstream level_file(dir + "level"), type_file(dir + "type"), size_file(dir + "size");
+        if (!level_file.is_open()) break;
+        int level = 0;
+        std::string type, size;
+        level_file >> level;
+        type_file >> type;
+        size_file >> size;
+        if (type == "Instruction") continue;
+        size_t bytes = parseCacheSize(size);
+        if (level > 0 && bytes > 0) sizes[level] = bytes;
+    }
+#ifdef __APPLE__
+    const char* names[] = {"hw.l1dcachesize", "hw.l2cachesize", "hw.l3cachesize"};
+    for (int level = 1; level <= 3 && sizes.size() < 3; level++) {
+        uint64_t value = 0;
+        size_t len = sizeof(value);
+        if (sizes.count(level) == 0 && sysctlbyname(names[level - 1], &value, &len, nullptr, 0) == 0 && value > 0) {
+            sizes[level] = value;
+        }
+    }
+#endif
+    if (sizes.empty()) {
+        std::cerr << "Cache sizes are not available, using 32K/1M/32M" << std::endl;
+        sizes = {{1, 32u << 10}, {2, 1u << 20}, {3, 32u << 20}};
+    }
+    std::vector<CacheLevel> levels;
+    for (const auto& entry : sizes) {
+        levels.push_back({entry.first, entry.second});
+    }
+    return levels;
+}
+
+/**
+ * @brief Подбирает количество элементов, при которых данные занимают доли каждого уровня кэша.
+ * @param levels Уровни кэша.
+ * @param element_bytes Размер одного элемента.
+ * @param max_elements Верхняя граница количества элементов.
+ * @return Отсортированные размеры без повторов.
+ */
+std::vector<size_t> cacheStraddlingSizes(const std::vector<CacheLevel>& levels, size_t element_bytes, size_t max_elements) {
+    const double fractions[] = {0.25, 0.5, 0.75, 0.9, 1.1, 1.25, 1.5, 2.0, 4.0};
+    std::vector<size_t> sizes;
+    for (const auto& level : levels) {
+        for (double fraction : fractions) {
+            size_t n = static_cast<size_t>(level.sizeBytes * fraction / element_bytes);
+            if (n >= 16 && n <= max_elements) sizes.push_back(n);
+        }
+    }
+    std::sort(sizes.begin(), sizes.end());
+    sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+    return sizes;
+}
+
+/**
+ * @brief Возвращает имя наименьшего уровня кэша, в который помещаются bytes.
+ * @param levels Уровни кэша.
+ * @param bytes Объём данных.
+ * @return "L1", "L2", ... или "DRAM".
+ */
+std::string cacheLevelFor(const std::vector<CacheLevel>& levels, size_t bytes) {
+    for (const auto& level : levels) {
+        if (bytes <= level.sizeBytes) return "L" + std::to_string(level.level);
+    }
+    return "DRAM";
+}
+
+/**
+ * @brief Прогоняет все алгоритмы на размерах, соседних с границами кэшей, для одного типа элементов.
+ * @tparam T Тип элементов (LotteryTicket или PackedTicketKey).
+ * @param layout Имя раскладки данных для отчёта.
+ * @param tickets Источник данных максимального размера.
+ * @param convert Преобразование префикса билетов в вектор T.
+ * @param levels Уровни кэша.
+ * @param quadratic_limit Наибольший размер для O(n²)-алгоритмов.
+ * @param out Поток для табличного отчёта.
+ */
+template<typename T, typename Convert>
+void sweepLayout(const std::string& layout, const std::vector<LotteryTicket>& tickets, Convert convert,
+                 const std::vector<CacheLevel>& levels, size_t quadratic_limit, std::ostream& out) {
+    for (size_t n : cacheStraddlingSizes(levels, sizeof(T), tickets.size())) {
+        std::vector<LotteryTicket> prefix(tickets.begin(), tickets.begin() + n);
+        std::vector<T> data = convert(prefix);
+        const size_t bytes = n * sizeof(T);
+        for (const auto& engine : sortEngines<T>()) {
+            if (engine.quadratic && n > quadratic_limit) continue;
+            TraceSpan span("sweep", layout + " " + engine.name + " " + std::to_string(n));
+            double ns = measureNsPerElement(engine, data);
+            std::cout << std::left << std::setw(8) << layout << std::setw(15) << engine.name << std::right
+                      << std::setw(10) << n << std::setw(12) << bytes / 1024 << " KiB "
+                      << std::setw(5) << cacheLevelFor(levels, bytes)
+                      << std::setw(10) << std::fixed << std::setprecision(2) << ns << " ns/elem" << std::endl;
+            out << layout << '\t' << engine.name << '\t' << n << '\t' << bytes << '\t'
+                << cacheLevelFor(levels, bytes) << '\t' << ns << std::endl;
+        }
+    }
+}
+
+/**
+ * @brief Режим "sweep": ищет обрывы производительности на границах кэшей.
+ * @details Размеры выбираются вокруг каждого уровня кэша отдельно для массива LotteryTicket
+ *          и для массива упакованных ключей. Данные синтетические (generateTickets).
+ *          Результат пишется в "cache_sweep.txt": раскладка, алгоритм, n, байты, уровень, нс/элемент.
+ * @param cmd Аргументы: `--max-elements=N` (по умолчанию 4 000 000), `--quadratic-limit=N` (по умолчанию 20 000),
+ *            `--seed=S`.
+ */
+void runCacheSweep(const CommandLine& cmd) {
+    auto levels = detectCacheLevels();
+    for (const auto& level : levels) {
+        std::cout << "L" << level.level << ": " << level.sizeBytes / 1024 << " KiB" << std::endl;
+    }
+    std::cout << "sizeof(LotteryTicket) = " << sizeof(LotteryTicket)
+              << ", sizeof(PackedTicketKey) = " << sizeof(PackedTicketKey) << std::endl;
+
+    const size_t max_elements = static_cast<size_t>(cmd.getInt("max-elements", 4000000));
+    const size_t quadratic_limit = static_cast<size_t>(cmd.getInt("quadratic-limit", 20000));
+    std::vector<LotteryTicket> tickets;
+    {
+        TraceSpan span("generate", std::to_string(max_elements));
+        tickets = generateTickets(max_elements, static_cast<unsigned>(cmd.getInt("seed", 1)));
+    }
+
+    std::ofstream out("cache_sweep.txt");
+    sweepLayout<LotteryTicket>("ticket", tickets, [](const std::vector<LotteryTicket>& t) { return t; },
+                               levels, quadratic_limit, out);
+    sweepLayout<PackedTicketKey>("key", tickets, packTicketKeys, levels, quadratic_limit, out);
+}
+
+// --- Холодный и тёплый кэш ---
+
+/**
+ * @class CacheEvictor
+ * @brief Вытесняет данные из кэшей, проходя по буферу больше последнего уровня кэша.
+ */
+class CacheEvictor {
+public:
+    /**
+     * @brief Выделяет буфер для вытеснения.
+     * @param llc_bytes Размер последнего уровня кэша. Буфер берётся вдвое больше.
+     */
+    explicit CacheEvictor(size_t llc_bytes) : buffer_(std::max<size_t>(2 * llc_bytes, 8u << 20) / sizeof(uint64_t), 1) {}
+
+    /**
+     * @brief Читает и перезаписывает весь буфер, вытесняя из кэшей всё остальное.
+     */
+    void evict() {
+        TraceSpan span("evict caches", std::to_string(buffer_.size() * sizeof(uint64_t)));
+        uint64_t sum = 0;
+        for (auto& word : buffer_) {
+            sum += word;
+            word = sum;
+        }
+        sink_ = sum;
+    }
+
+    /**
+     * @brief Просит ядро выгрузить страницы диапазона, чтобы первое обращение снова вызвало page fault.
+     * @details Работает только на Linux 5.4+ (MADV_PAGEOUT) и только при наличии swap;
+     *          в остальных случаях ничего не делает.
+     * @param data Начало диапазона.
+     * @param bytes Размер диапазона.
+     * @return true, если подсказка была принята ядром.
+     */
+    static bool pageOut(const void* data, size_t bytes) {
+#ifdef MADV_PAGEOUT
+        const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + page - 1) & ~(page - 1);
+        uintptr_t end = (reinterpret_cast<uintptr_t>(data) + bytes) & ~(page - 1);
+        if (end <= begin) return false;
+        return madvise(reinterpret_cast<void*>(begin), end - begin, MADV_PAGEOUT) == 0;
+#else
+        (void)data;
+        (void)bytes;
+        return false;
+#endif
+    }
+
+private:
+    std::vector<uint64_t> buffer_;
+    volatile uint64_t sink_ = 0;
+};
+
+/**
+ * @brief Возвращает суммарное количество page fault'ов процесса.
+ */
+long long pageFaultCount() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt + usage.ru_majflt;
+}
+
+/**
+ * @brief Проверяет, что CacheEvictor::pageOut действительно выгружает анонимные страницы.
+ * @details madvise(MADV_PAGEOUT) возвращает 0 и без swap, когда выгружать анонимную память некуда,
+ *          поэтому пробный буфер выгружается и читается снова: страницы должны вызвать page fault'ы.
+ * @return true, если повторное чтение вызвало page fault хотя бы на половине страниц.
+ */
+bool pageOutRefaults() {
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t pages = 256;
+    std::vector<char> probe(pages * page + page, 1);
+    if (!CacheEvictor::pageOut(probe.data(), probe.size())) return false;
+    const long long faults_before = pageFaultCount();
+    volatile char sum = 0;
+    for (size_t i = 0; i < probe.size(); i += page) sum += probe[i];
+    (void)sum;
+    return pageFaultCount() - faults_before >= static_cast<long long>(pages / 2);
+}
+
+/**
+ * @struct ColdWarmResult
+ * @brief Результат одного замера в режиме "coldwarm".
+ */
+struct ColdWarmResult {
+    double ms;        ///< Время сортировки, мс.
+    long long faults; ///< Количество page fault'ов во время сортировки.
+};
+
+/**
+ * @brief Один замер сортировки: копирование, при необходимости вытеснение кэшей, сортировка.
+ * @param engine Алгоритм.
+ * @param data Исходные данные.
+ * @param evictor Вытеснитель кэшей или nullptr для тёплого замера.
+ * @param refault Выгружать ли страницы копии после вытеснения.
+ * @return Время и количество page fault'ов.
+ */
+ColdWarmResult measureColdWarm(const SortEngine<LotteryTicket>& engine, const std::vector<LotteryTicket>& data,
+                               CacheEvictor* evictor, bool refault) {
+    std::vector<LotteryTicket> copy = copyTickets(data);
+    if (evictor != nullptr) {
+        evictor->evict();
+        if (refault) CacheEvictor::pageOut(copy.data(), copy.size() * sizeof(LotteryTicket));
+    }
+    long long faults_before = pageFaultCount();
+    auto start = std::chrono::steady_clock::now();
+    {
+        TraceSpan span("sort", engine.name + (evictor ? " cold " : " warm ") + std::to_string(copy.size()));
+        engine.sort(copy);
+    }
+    auto end = std::chrono::steady_clock::now();
+    long long faults = pageFaultCount() - faults_before;
+    verifySorted(copy, engine.name);
+    return {std::chrono::duration<double, std::milli>(end - start).count(), faults};
+}
+
+/**
+ * @brief Режим "coldwarm": сравнивает сортировку данных, только что скопированных в кэш, и вытесненных из него.
+ * @details Перед каждым холодным замером CacheEvictor проходит по буферу вдвое больше LLC.
+ *          С `--refault` страницы копии дополнительно выгружаются через madvise, чтобы сортировка
+ *          начиналась с page fault'ов, как на свежеразобранных данных; если пробная выгрузка
+ *          не вызывает page fault'ов (например, нет swap), режим отключается с предупреждением. Результаты (медианы)
+ *          пишутся в "cold_warm.txt": размер, алгоритм, тёплое время, холодное время, page fault'ы.
+ * @param cmd Аргументы: `--sizes=N,...` (наборы lottery_N.txt), `--runs=R`, `--refault`,
+ *            `--quadratic-limit=N` (по умолчанию 10 000).
+ */
+void runColdWarm(const CommandLine& cmd) {
+    const auto sizes = cmd.getIntList("sizes", {1000, 10000, 50000, 100000});
+    const int runs = static_cast<int>(std::max(1LL, cmd.getInt("runs", 5)));
+    const size_t quadratic_limit = static_cast<size_t>(cmd.getInt("quadratic-limit", 10000));
+    bool refault = cmd.has("refault");
+
+    auto levels = detectCacheLevels();
+    CacheEvictor evictor(levels.back().sizeBytes);
+    if (refault && !pageOutRefaults()) {
+        std::cout << "Note: MADV_PAGEOUT is not available or has no effect (no swap?), --refault only evicts caches" << std::endl;
+        refault = false;
+    }
+
+    std::ofstream out("cold_warm.txt");
+    std::cout << std::left << std::setw(10) << "size" << std::setw(15) << "algorithm" << std::right
+              << std::setw(12) << "warm, ms" << std::setw(12) << "cold, ms" << std::setw(8) << "ratio"
+              << std::setw(10) << "faults" << std::endl;
+    for (long long size : sizes) {
+        auto tickets = readTicketsFromFile("lottery_" + std::to_string(size) + ".txt");
+        for (const auto& engine : sortEngines<LotteryTicket>()) {
+            if (engine.quadratic && tickets.size() > quadratic_limit) continue;
+            std::vector<double> warm, cold;
+            long long faults = 0;
+            // Чередуем замеры, чтобы медленный дрейф частоты одинаково влиял на оба режима
+            for (int run = 0; run < runs; run++) {
+                warm.push_back(measureColdWarm(engine, tickets, nullptr, false).ms);
+                ColdWarmResult result = measureColdWarm(engine, tickets, &evictor, refault);
+                cold.push_back(result.ms);
+                faults += result.faults;
+            }
+            std::sort(warm.begin(), warm.end());
+            std::sort(cold.begin(), cold.end());
+            double warm_ms = warm[warm.size() / 2], cold_ms = cold[cold.size() / 2];
+            std::cout << std::left << std::setw(10) << size << std::setw(15) << engine.name << std::right
+                      << std::fixed << std::setprecision(3) << std::setw(12) << warm_ms << std::setw(12) << cold_ms
+                      << std::setprecision(2) << std::setw(8) << (warm_ms > 0 ? cold_ms / warm_ms : 0.0)
+                      << std::setw(10) << faults / runs << std::endl;
+            out << size << '\t' << engine.name << '\t' << warm_ms << '\t' << cold_ms << '\t' << faults / runs << std::endl;
+        }
+    }
+}
+
+// --- Энергопотребление ---
+
+/**
+ * @class EnergyMeter
+ * @brief Счётчики энергии процессора: RAPL через powercap или amd_energy через hwmon.
+ * @details Используются зоны верхнего уровня /sys/class/powercap/intel-rapl:N (пакеты; на AMD Zen
+ *          ядро публикует их под тем же именем) и, если их нет, счётчики сокетов драйвера amd_energy.
+ *          Если ни один счётчик не читается (нет драйвера, нет прав), available() возвращает false.
+ */
+class EnergyMeter {
+public:
+    /** @brief Находит доступные счётчики. */
+    EnergyMeter() {
+        for (int zone = 0; zone < 16; zone++) {
+            std::string dir = "/sys/class/powercap/intel-rapl:" + std::to_string(zone) + "/";
+            std::string name = readLine(dir + "name");
+            // psys охватывает всю платформу вместе с пакетами, его сложение с ними дало бы двойной счёт
+            if (name != "psys") addCounter(dir + "energy_uj", dir + "max_energy_range_uj", name);
+        }
+        for (int hwmon = 0; hwmon < 64 && counters_.empty(); hwmon++) {
+            std::string dir = "/sys/class/hwmon/hwmon" + std::to_string(hwmon) + "/";
+            if (readLine(dir + "name") != "amd_energy") continue;
+            for (int input = 1; input < 512; input++) {
+                std::string prefix = dir + "energy" + std::to_string(input);
+                std::string label = readLine(prefix + "_label");
+                if (label.empty()) break;
+                if (label.rfind("Esocket", 0) == 0) addCounter(prefix + "_input", "", label);
+            }
+        }
+    }
+
+    /** @brief Есть ли хотя бы один читаемый счётчик. */
+    bool available() const { return !counters_.empty(); }
+
+    /** @brief Имена используемых счётчиков через запятую. */
+    std::string describe() const {
+        std::string names;
+        for (const auto& counter : counters_) {
+            names += (names.empty() ? "" : ", ") + counter.name;
+        }
+        return names;
+    }
+
+    /**
+     * @brief Снимает показания всех счётчиков.
+     * @return Показания в микроджоулях в порядке counters_.
+     */
+    std::vector<unsigned long long> sample() const {
+        std::vector<unsigned long long> values;
+        for (const auto& counter : counters_) {
+            values.push_back(readCounter(counter.path));
+        }
+        return values;
+    }
+
+    /**
+     * @brief Энергия, потраченная с момента снятия показаний.
+     * @details Учитывает однократное переполнение счётчика по max_energy_range_uj.
+     * @param before Показания, полученные sample().
+     * @return Суммарная энергия по всем счётчикам, Дж.
+     */
+    double joulesSince(const std::vector<unsigned long long>& before) const {
+        auto after = sample();
+        double microjoules = 0;
+        for (size_t i = 0; i < counters_.size(); i++) {
+            if (after[i] >= before[i]) {
+                microjoules += static_cast<double>(after[i] - before[i]);
+            } else if (counters_[i].maxRange > 0) {
+                microjoules += static_cast<double>(counters_[i].maxRange - before[i] + after[i]);
+            }
+        }
+        return microjoules / 1e6;
+    }
+
+private:
+    struct Counter {
+        std::string path;
+        std::string name;
+        unsigned long long maxRange;
+    };
+
+    static std::string readLine(const std::string& path) {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return line;
+    }
+
+    static unsigned long long readCounter(const std::string& path) {
+        std::ifstream file(path);
+        unsigned long long value = 0;
+        file >> value;
+        return value;
+    }
+
+    void addCounter(const std::string& path, const std::string& range_path, const std::string& name) {
+        std::ifstream probe(path);
+        unsigned long long value = 0;
+        if (!(probe >> value)) return;
+        counters_.push_back({path, name, range_path.empty() ? 0 : readCounter(range_path)});
+    }
+
+    std::vector<Counter> counters_;
+};
+
+/**
+ * @brief Режим "energy": энергия на сортировку по счётчикам RAPL.
+ * @details Каждый алгоритм повторяется, пока суммарное время не превысит `--min-ms`, чтобы
+ *          энергия заметно превышала разрешение счётчика. Сортировки идут партиями: партия копий
+ *          заполняется вне замера, её размер удваивается, но не больше, чем помещается в `--pool-mb`
+ *          (без учёта строк в куче). Из полной энергии пакета вычитается
+ *          фоновая мощность, измеренная в простое перед замерами. Результаты пишутся
+ *          в "energy_sorts.txt": размер, алгоритм, мс на сортировку, Дж на сортировку,
+ *          Дж на миллион билетов, Дж сверх простоя.
+ * @param cmd Аргументы: `--sizes=N,...` (наборы lottery_N.txt), `--min-ms=T` (по умолчанию 500),
+ *            `--quadratic-limit=N` (по умолчанию 10 000), `--pool-mb=M` (по умолчанию 64).
+ */
+void runEnergy(const CommandLine& cmd) {
+    EnergyMeter meter;
+    if (!meter.available()) {
+        std::cout << "Energy counters are not available (no RAPL/amd_energy or no read permission)" << std::endl;
+        return;
+    }
+    std::cout << "Energy counters: " << meter.describe() << std::endl;
+
+    const auto sizes = cmd.getIntList("sizes", {10000, 100000});
+    const double min_ms = static_cast<double>(cmd.getInt("min-ms", 500));
+    const size_t quadratic_limit = static_cast<size_t>(cmd.getInt("quadratic-limit", 10000));
+    const size_t pool_bytes = static_cast<size_t>(std::max(1LL, cmd.getInt("pool-mb", 64))) << 20;
+
+    double idle_watts = 0;
+    {
+        TraceSpan span("idle power");
+        auto before = meter.sample();
+        auto start = std::chrono::steady_clock::now();
+        timespec pause{0, 500000000};
+        nanosleep(&pause, nullptr);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        idle_watts = meter.joulesSince(before) / seconds;
+    }
+    std::cout << "Idle power: " << std::fixed << std::setprecision(2) << idle_watts << " W" << std::endl;
+
+    std::ofstream out("energy_sorts.txt");
+    std::cout << std::left << std::setw(10) << "size" << std::setw(15) << "algorithm" << std::right
+              << std::setw(12) << "ms/sort" << std::setw(12) << "J/sort" << std::setw(12) << "J/Mticket"
+              << std::setw(14) << "net J/sort" << std::endl;
+    for (long long size : sizes) {
+        auto tickets = readTicketsFromFile("lottery_" + std::to_string(size) + ".txt");
+        const size_t copy_bytes = std::max<size_t>(1, tickets.size() * sizeof(LotteryTicket));
+        const size_t max_copies = std::max<size_t>(1, pool_bytes / copy_bytes);
+        for (const auto& engine : sortEngines<LotteryTicket>()) {
+            if (engine.quadratic && tickets.size() > quadratic_limit) continue;
+            TraceSpan span("energy", engine.name + " " + std::to_string(size));
+            // Копии готовим между замерами в пуле ограниченного размера, чтобы в замер попала только сортировка
+            std::vector<std::vector<LotteryTicket>> pool;
+            int runs = 0;
+            double total_ms = 0, joules = 0;
+            size_t batch = 1;
+            while (runs == 0 || total_ms < min_ms) {
+                pool.resize(batch);
+                for (auto& copy : pool) copy = tickets;
+                auto before = meter.sample();
+                auto start = std::chrono::steady_clock::now();
+                for (auto& copy : pool) engine.sort(copy);
+                auto end = std::chrono::steady_clock::now();
+                joules += meter.joulesSince(before);
+                total_ms += std::chrono::duration<double, std::milli>(end - start).count();
+                runs += static_cast<int>(pool.size());
+                verifySorted(pool.back(), engine.name);
+                batch = std::min(batch * 2, max_copies);
+            }
+            double ms = total_ms / runs, j = joules / runs;
+            double net = j - idle_watts * ms / 1000.0;
+            double per_million = j * 1e6 / std::max<size_t>(tickets.size(), 1);
+            std::cout << std::left << std::setw(10) << size << std::setw(15) << engine.name << std::right
+                      << std::setprecision(3) << std::setw(12) << ms << std::setw(12) << j
+                      << std::setw(12) << per_million << std::setw(14) << net << std::endl;
+            out << size << '\t' << engine.name << '\t' << ms << '\t' << j << '\t' << per_million << '\t' << net << std::endl;
+        }
+    }
+}
+
+// --- Локальность памяти NUMA ---
+
+/**
+ * @class NodeAccessCounter
+ * @brief Счётчики perf обращений к памяти узлов: все (node-loads) и к чужому узлу (node-load-misses).
+ * @details Событие PERF_COUNT_HW_CACHE_NODE считает загрузки, дошедшие до памяти: ACCESS — все,
+ *          MISS — обслуженные памятью другого узла. Счётчики наследуются потоками, созданными
+ *          после start(). Если ядро или процессор их не поддерживают либо не хватает прав
+ *          (perf_event_paranoid), available() возвращает false.
+ */
+class NodeAccessCounter {
+public:
+    /** @brief Открывает счётчики для текущего процесса. */
+    NodeAccessCounter() {
+        accessFd_ = open(PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+        missFd_ = open(PERF_COUNT_HW_CACHE_RESULT_MISS);
+        if (accessFd_ < 0 || missFd_ < 0) {
+            closeAll();
+        }
+    }
+
+    NodeAccessCounter(const NodeAccessCounter&) = delete;
+    NodeAccessCounter& operator=(const NodeAccessCounter&) = delete;
+
+    ~NodeAccessCounter() { closeAll(); }
+
+    /** @brief true, если оба счётчика открыты. */
+    bool available() const { return accessFd_ >= 0; }
+
+    /** @brief Обнуляет и запускает счётчики. */
+    void start() {
+#ifdef __linux__
+        for (int fd : {accessFd_, missFd_}) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    /**
+     * @brief Останавливает счётчики.
+     * @return Пара (все обращения к памяти узлов, обращения к чужому узлу); (-1, -1), если недоступно.
+     */
+    std::pair<long long, long long> stop() {
+        if (!available()) return {-1, -1};
+#ifdef __linux__
+        long long values[2] = {0, 0};
+        int fds[2] = {accessFd_, missFd_};
+        for (int i = 0; i < 2; i++) {
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i])) return {-1, -1};
+        }
+        return {values[0], values[1]};
+#else
+        return {-1, -1};
+#endif
+    }
+
+private:
+    static int open(int result) {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (static_cast<uint64_t>(result) << 16);
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void)result;
+        return -1;
+#endif
+    }
+
+    void closeAll() {
+        if (accessFd_ >= 0) close(accessFd_);
+        if (missFd_ >= 0) close(missFd_);
+        accessFd_ = missFd_ = -1;
+    }
+
+    int accessFd_ = -1;
+    int missFd_ = -1;
+};
+
+/**
+ * @brief Режим "numa": сравнивает параллельные алгоритмы по времени и доле обращений к чужому узлу.
+ * @details Печатает топологию узлов, затем для parallelSort, parallelSampleSort и numaSort — медиану
+ *          времени и, если доступны счётчики perf, доли локальных и удалённых обращений к памяти.
+ *          Результаты пишутся в "numa_sorts.txt": размер, алгоритм, мс, локальная доля, удалённая доля
+ *          (-1, если счётчики недоступны).
+ * @param cmd Аргументы: `--sizes=N,...` (наборы lottery_N.txt), `--runs=R` (по умолчанию 3).
+ */
+void runNuma(const CommandLine& cmd) {
+    const auto sizes = cmd.getIntList("sizes", {100000});
+    const int runs = static_cast<int>(std::max(1LL, cmd.getInt("runs", 3)));
+
+    const auto nodes = detectNumaNodes();
+    for (const auto& node : nodes) {
+        std::cout << "node" << node.id << ": " << node.cpus.size() << " cpus" << std::endl;
+    }
+    if (nodes.size() == 1) {
+        std::cout << "Note: single NUMA node, all accesses are local" << std::endl;
+    }
+    NodeAccessCounter counter;
+    if (!counter.available()) {
+        std::cout << "Note: perf node-load counters are not available, ratios are not reported" << std::endl;
+    }
+
+    const std::vector<SortEngine<LotteryTicket>> engines = {
+        {"parallelSort", [](std::vector<LotteryTicket>& a) { parallelSort(a); }, false},
+        {"parallelSampleSort", [](std::vector<LotteryTicket>& a) { parallelSampleSort(a); }, false},
+        {"numaSort", [](std::vector<LotteryTicket>& a) { numaSort(a); }, false},
+    };
+    std::ofstream out("numa_sorts.txt");
+    std::cout << std::left << std::setw(10) << "size" << std::setw(20) << "algorithm" << std::right
+              << std::setw(12) << "ms" << std::setw(10) << "local" << std::setw(10) << "remote" << std::endl;
+    for (long long size : sizes) {
+        auto tickets = readTicketsFromFile("lottery_" + std::to_string(size) + ".txt");
+        for (const auto& engine : engines) {
+            std::vector<double> times;
+            long long accesses = 0, remote = 0;
+            for (int run = 0; run < runs; run++) {
+                auto copy = copyTickets(tickets);
+                counter.start();
+                auto start = std::chrono::steady_clock::now();
+                {
+                    TraceSpan span("sort", engine.name + " " + std::to_string(copy.size()));
+                    engine.sort(copy);
+                }
+                auto end = std::chrono::steady_clock::now();
+                auto counts = counter.stop();
+                accesses += counts.first;
+                remote += counts.second;
+                verifySorted(copy, engine.name);
+                times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            }
+            std::sort(times.begin(), times.end());
+            const bool measured = counter.available() && accesses > 0;
+            const double remote_share = measured ? static_cast<double>(remote) / accesses : -1.0;
+            const double local_share = measured ? 1.0 - remote_share : -1.0;
+            std::cout << std::left << std::setw(10) << size << std::setw(20) << engine.name << std::right
+                      << std::fixed << std::setprecision(3) << std::setw(12) << times[times.size() / 2]
+                      << std::setprecision(2) << std::setw(10) << local_share << std::setw(10) << remote_share << std::endl;
+            out << size << '\t' << engine.name << '\t' << times[times.size() / 2] << '\t' << local_share << '\t' << remote_share << std::endl;
+        }
+    }
+}
+
+// --- Сравнение всех алгоритмов ---
+
+/**
+ * @brief Печатает строку таблицы режима "engines" и дублирует её в файл.
+ */
+void reportEngineTime(std::ostream& out, const std::string& dataset, const std::string& engine, size_t n, double ms) {
+    std::cout << std::left << std::setw(20) << dataset << std::setw(20) << engine << std::right
+              << std::setw(10) << n << std::fixed << std::setprecision(3) << std::setw(12) << ms << " ms" << std::endl;
+    out << dataset << '\t' << engine << '\t' << n << '\t' << ms << std::endl;
+}
+
+/**
+ * @brief Режим "engines": сравнивает все алгоритмы из реестра на файлах lottery_N.txt.
+ * @details Для каждого набора сначала печатается решение sortTickets, затем медиана времени
+ *          каждого алгоритма. Каждый результат проверяется на упорядоченность.
+ *          Результаты пишутся в "engine_times.txt": набор, алгоритм, n, мс.
+ * @param cmd Аргументы: `--sizes=N,...`, `--runs=R` (по умолчанию 5), `--quadratic-limit=N` (по умолчанию 10 000).
+ */
+void runEngines(const CommandLine& cmd) {
+    const auto sizes = cmd.getIntList("sizes", {1000, 10000, 100000});
+    const int runs = static_cast<int>(std::max(1LL, cmd.getInt("runs", 5)));
+    const size_t quadratic_limit = static_cast<size_t>(cmd.getInt("quadratic-limit", 10000));
+
+    std::ofstream out("engine_times.txt");
+    for (long long size : sizes) {
+        const std::string dataset = "lottery_" + std::to_string(size) + ".txt";
+        auto tickets = readTicketsFromFile(dataset);
+        {
+            auto probe = tickets;
+            sortTickets(probe, &std::cout);
+        }
+        for (const auto& engine : sortEngines<LotteryTicket>()) {
+            if (engine.quadratic && tickets.size() > quadratic_limit) continue;
+            std::vector<double> times;
+            for (int run = 0; run < runs; run++) {
+                auto copy = copyTickets(tickets);
+                auto start = std::chrono::steady_clock::now();
+                {
+                    TraceSpan span("sort", engine.name + " " + std::to_string(copy.size()));
+                    engine.sort(copy);
+                }
+                auto end = std::chrono::steady_clock::now();
+                verifySorted(copy, engine.name);
+                times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            }
+            std::sort(times.begin(), times.end());
+            reportEngineTime(out, dataset, engine.name, tickets.size(), times[times.size() / 2]);
+        }
+    }
+}
+
+// --- Синтетические наборы ---
+
+/**
+ * @brief Сравнение билетов только по призовому уровню: (дата, -выигрыш), без номера.
+ */
+struct PrizeTierLess {
+    /** @brief true, если a раньше b по (дате, -выигрышу). */
+    bool operator()(const LotteryTicket& a, const LotteryTicket& b) const {
+        if (a.lotteryDate != b.lotteryDate) return a.lotteryDate < b.lotteryDate;
+        return a.winAmount > b.winAmount;
+    }
+};
+
+/**
+ * @brief Создаёт синтетический набор по имени профиля.
+ * @param profile "random" — как lottery_N.txt, "dups" — много повторяющихся ключей,
+ *                "zipf" — выигрыши по закону Ципфа.
+ * @param n Количество билетов.
+ * @param seed Зерно генератора.
+ * @throws std::runtime_error Если профиль неизвестен.
+ */
+std::vector<LotteryTicket> generateProfile(const std::string& profile, size_t n, unsigned seed) {
+    if (profile == "random") return generateTickets(n, seed);
+    if (profile == "dups") return generateDuplicateHeavyTickets(n, seed);
+    if (profile == "zipf") return generateZipfTickets(n, seed);
+    throw std::runtime_error("Unknown data profile: " + profile);
+}
+
+/**
+ * @brief Режим "synth": сравнивает алгоритмы из реестра на синтетических наборах.
+ * @details Для каждого профиля печатается решение sortTickets и нс/элемент каждого алгоритма.
+ *          На профиле "dups" дополнительно сравниваются сортировки по неполному ключу
+ *          (дата, выигрыш), где равных элементов особенно много, включая устойчивые.
+ *          Результаты пишутся в "synth_times.txt": профиль, алгоритм, n, нс/элемент.
+ * @param cmd Аргументы: `--profiles=a,b` (по умолчанию random,dups,zipf), `--n=N` (по умолчанию 1 000 000),
+ *            `--seed=S`, `--quadratic-limit=N` (по умолчанию 10 000).
+ */
+void runSynthetic(const CommandLine& cmd) {
+    const size_t n = static_cast<size_t>(std::max(1LL, cmd.getInt("n", 1000000)));
+    const unsigned seed = static_cast<unsigned>(cmd.getInt("seed", 1));
+    const size_t quadratic_limit = static_cast<size_t>(cmd.getInt("quadratic-limit", 10000));
+    std::vector<std::string> profiles;
+    std::stringstream ss(cmd.get("profiles", "random,dups,zipf"));
+    for (std::string profile; std::getline(ss, profile, ',');) profiles.push_back(profile);
+
+    std::ofstream out("synth_times.txt");
+    auto report = [&](const std::string& profile, const std::string& engine, double ns) {
+        std::cout << std::left << std::setw(10) << profile << std::setw(28) << engine << std::right
+                  << std::setw(10) << n << std::fixed << std::setprecision(2) << std::setw(10) << ns << " ns/elem" << std::endl;
+        out << profile << '\t' << engine << '\t' << n << '\t' << ns << std::endl;
+    };
+    for (const auto& profile : profiles) {
+        std::vector<LotteryTicket> data;
+        {
+            TraceSpan span("generate", profile + " " + std::to_string(n));
+            data = generateProfile(profile, n, seed);
+        }
+        {
+            auto probe = data;
+            sortTickets(probe, &std::cout);
+        }
+        for (const auto& engine : sortEngines<LotteryTicket>()) {
+            if (engine.quadratic && n > quadratic_limit) continue;
+            TraceSpan span("synth", profile + " " + engine.name);
+            report(profile, engine.name, measureNsPerElement(engine, data));
+        }
+        if (profile == "dups") {
+            std::vector<SortEngine<LotteryTicket>> partial = {
+                {"std::sort (date,win)", [](std::vector<LotteryTicket>& a) { std::sort(a.begin(), a.end(), PrizeTierLess()); }, false},
+                {"quickSort3Way (date,win)", [](std::vector<LotteryTicket>& a) { quickSort3Way(a, PrizeTierLess()); }, false},
+                {"std::stable_sort (date,win)", [](std::vector<LotteryTicket>& a) { std::stable_sort(a.begin(), a.end(), PrizeTierLess()); }, false},
+                {"blockMergeSort (date,win)", [](std::vector<LotteryTicket>& a) { blockMergeSort(a, PrizeTierLess()); }, false},
+            };
+            for (const auto& engine : partial) {
+                report(profile, engine.name, measureNsPerElement(engine, data));
+            }
+        }
+    }
+}
+
+// --- Сортировка файла на месте с минимумом записей ---
+
+/**
+ * @brief Записывает билеты в двоичный файл из TicketRecord.
+ * @param filename Имя файла.
+ * @param records Записи.
+ * @throws std::runtime_error Если файл не удалось записать.
+ */
+void writeTicketRecordFile(const std::string& filename, const std::vector<TicketRecord>& records) {
+    TraceSpan span("write records", filename);
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file for writing: " + filename);
+    }
+    file.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(TicketRecord)));
+    if (!file) {
+        throw std::runtime_error("Could not write file: " + filename);
+    }
+}
+
+/**
+ * @class MappedTicketFile
+ * @brief Двоичный файл билетов, отображённый в память для чтения и записи (MAP_SHARED).
+ * @details Записи изменяются прямо в страничном кэше файла; sync() сбрасывает грязные страницы на диск.
+ */
+class MappedTicketFile {
+public:
+    /**
+     * @brief Открывает и отображает файл.
+     * @param filename Имя файла из TicketRecord.
+     * @throws std::runtime_error Если файл не открывается, не отображается или его размер не кратен записи.
+     */
+    explicit MappedTicketFile(const std::string& filename) {
+        fd_ = open(filename.c_str(), O_RDWR);
+        if (fd_ < 0) {
+            throw std::runtime_error("Could not open file: " + filename);
+        }
+        struct stat st{};
+        if (fstat(fd_, &st) != 0 || st.st_size % sizeof(TicketRecord) != 0) {
+            close(fd_);
+            throw std::runtime_error("Not a ticket record file: " + filename);
+        }
+        bytes_ = static_cast<size_t>(st.st_size);
+        if (bytes_ > 0) {
+            void* data = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (data == MAP_FAILED) {
+                close(fd_);
+                throw std::runtime_error("Could not map file: " + filename);
+            }
+            data_ = static_cast<TicketRecord*>(data);
+        }
+    }
+
+    MappedTicketFile(const MappedTicketFile&) = delete;
+    MappedTicketFile& operator=(const MappedTicketFile&) = delete;
+
+    /** @brief Снимает отображение и закрывает файл. */
+    ~MappedTicketFile() {
+        if (data_ != nullptr) munmap(data_, bytes_);
+        close(fd_);
+    }
+
+    TicketRecord* data() { return data_; }                        ///< Первая запись.
+    size_t size() const { return bytes_ / sizeof(TicketRecord); } ///< Количество записей.
+    size_t bytes() const { return bytes_; }                       ///< Размер файла, байт.
+
+    /** @brief Синхронно сбрасывает изменённые страницы в файл. */
+    void sync() {
+        if (data_ != nullptr) msync(data_, bytes_, MS_SYNC);
+    }
+
+private:
+    int fd_ = -1;
+    TicketRecord* data_ = nullptr;
+    size_t bytes_ = 0;
+};
+
+/**
+ * @struct WriteTracker
+ * @brief Счётчик записей элементов в отображённый диапазон и страниц, которые они испачкали.
+ */
+struct WriteTracker {
+    const char* base = nullptr; ///< Начало отслеживаемого диапазона.
+    size_t bytes = 0;           ///< Размер диапазона.
+    size_t pageSize = 4096;     ///< Размер страницы.
+    size_t writes = 0;          ///< Количество записей элементов в диапазон.
+    std::vector<bool> dirty;    ///< Испачканные страницы.
+
+    /** @brief Начинает отслеживание диапазона с нуля. */
+    void reset(const void* data, size_t size) {
+        base = static_cast<const char*>(data);
+        bytes = size;
+        pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        writes = 0;
+        dirty.assign((size + pageSize - 1) / pageSize, false);
+    }
+
+    /** @brief Учитывает запись по адресу p; записи во временные объекты вне диапазона не считаются. */
+    void note(const void* p) {
+        const char* at = static_cast<const char*>(p);
+        if (at < base || at >= base + bytes) return;
+        writes++;
+        const size_t offset = static_cast<size_t>(at - base);
+        dirty[offset / pageSize] = true;
+        dirty[(offset + sizeof(TicketRecord) - 1) / pageSize] = true;
+    }
+
+    /** @brief Записывает запись в слот и учитывает запись. */
+    void store(TicketRecord* slot, const TicketRecord& value) {
+        *slot = value;
+        note(slot);
+    }
+
+    /** @brief Количество испачканных страниц. */
+    size_t dirtyPages() const { return static_cast<size_t>(std::count(dirty.begin(), dirty.end(), true)); }
+};
+
+WriteTracker g_writeTracker; ///< Счётчик записей для TrackedRecordIterator.
+
+/**
+ * @class TrackedRecordRef
+ * @brief Ссылка на TicketRecord в отображённом файле: чтение — как обычно, запись — через g_writeTracker.store.
+ */
+class TrackedRecordRef {
+public:
+    explicit TrackedRecordRef(TicketRecord* slot) : slot_(slot) {}
+    TrackedRecordRef(const TrackedRecordRef&) = default;
+
+    /** @brief Значение записи. */
+    operator TicketRecord() const { return *slot_; }
+
+    /** @brief Запись с учётом. */
+    TrackedRecordRef& operator=(const TicketRecord& value) {
+        g_writeTracker.store(slot_, value);
+        return *this;
+    }
+
+    /** @brief Копирует значение другой записи (а не саму ссылку). */
+    TrackedRecordRef& operator=(const TrackedRecordRef& other) { return *this = static_cast<TicketRecord>(other); }
+
+    /** @brief Обмен значениями двух записей (две учтённые записи). */
+    friend void swap(TrackedRecordRef a, TrackedRecordRef b) {
+        const TicketRecord held = a;
+        a = static_cast<TicketRecord>(b);
+        b = held;
+    }
+
+private:
+    TicketRecord* slot_;
+};
+
+/**
+ * @class TrackedRecordIterator
+ * @brief Итератор произвольного доступа по массиву TicketRecord, разыменование которого даёт TrackedRecordRef.
+ * @details Позволяет запускать стандартные алгоритмы прямо на отображённом файле и считать, сколько
+ *          записей и грязных страниц они порождают; к памяти файла обращаются только как к TicketRecord.
+ */
+class TrackedRecordIterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = TicketRecord;
+    using difference_type = std::ptrdiff_t;
+    using pointer = TicketRecord*;
+    using reference = TrackedRecordRef;
+
+    TrackedRecordIterator() = default;
+    explicit TrackedRecordIterator(TicketRecord* at) : at_(at) {}
+
+    reference operator*() const { return TrackedRecordRef(at_); }
+    reference operator[](difference_type i) const { return TrackedRecordRef(at_ + i); }
+    TrackedRecordIterator& operator++() { ++at_; return *this; }
+    TrackedRecordIterator& operator--() { --at_; return *this; }
+    TrackedRecordIterator operator++(int) { return TrackedRecordIterator(at_++); }
+    TrackedRecordIterator operator--(int) { return TrackedRecordIterator(at_--); }
+    TrackedRecordIterator& operator+=(difference_type i) { at_ += i; return *this; }
+    TrackedRecordIterator& operator-=(difference_type i) { at_ -= i; return *this; }
+    TrackedRecordIterator operator+(difference_type i) const { return TrackedRecordIterator(at_ + i); }
+    TrackedRecordIterator operator-(difference_type i) const { return TrackedRecordIterator(at_ - i); }
+    friend TrackedRecordIterator operator+(difference_type i, TrackedRecordIterator it) { return it + i; }
+    difference_type operator-(const TrackedRecordIterator& other) const { return at_ - other.at_; }
+    bool operator==(const TrackedRecordIterator& other) const { return at_ == other.at_; }
+    bool operator!=(const TrackedRecordIterator& other) const { return at_ != other.at_; }
+    bool operator<(const TrackedRecordIterator& other) const { return at_ < other.at_; }
+    bool operator>(const TrackedRecordIterator& other) const { return at_ > other.at_; }
+    bool operator<=(const TrackedRecordIterator& other) const { return at_ <= other.at_; }
+    bool operator>=(const TrackedRecordIterator& other) const { return at_ >= other.at_; }
+
+private:
+    TicketRecord* at_ = nullptr;
+};
+
+/** @brief Порядок двоичных записей билетов. */
+struct TicketRecordLess {
+    bool operator()(const TicketRecord& a, const TicketRecord& b) const { return packTicketKey(a) < packTicketKey(b); }
+};
+
+/**
+ * @brief Сортировка с минимальным числом записей: перестановка вычисляется отдельно и применяется обходом циклов.
+ * @details Сначала сортируются только пары (ключ, индекс) в обычной памяти — массив при этом не меняется.
+ *          Затем перестановка применяется по циклам: первый элемент цикла откладывается во временную
+ *          переменную, остальные сдвигаются на свои места по одному разу. Каждый элемент, стоящий
+ *          не на своём месте, записывается ровно один раз, стоящие на месте не трогаются — это минимум
+ *          записей для любой сортировки на месте (как в cycle sort, но за O(n log n) сравнений вместо O(n²)).
+ *          На почти отсортированном файле пачкаются только страницы с переставленными записями.
+ * @tparam Iter Итератор произвольного доступа (указатель или TrackedRecordIterator), значения которого
+ *         имеют перегрузку packTicketKey.
+ * @param data Первый элемент массива (например, отображённого файла).
+ * @param n Количество элементов.
+ * @return Количество записанных элементов.
+ */
+template<typename Iter>
+size_t cycleWalkSort(Iter data, size_t n) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    std::vector<std::pair<PackedTicketKey, size_t>> order(n);
+    for (size_t i = 0; i < n; i++) order[i] = {packTicketKey(static_cast<T>(data[i])), i};
+    // Индекс — второй ключ, чтобы равные элементы не переставлялись зря
+    std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first < b.first : a.second < b.second;
+    });
+
+    size_t writes = 0;
+    std::vector<bool> placed(n, false);
+    for (size_t start = 0; start < n; start++) {
+        if (placed[start] || order[start].second == start) continue;
+        const T held = data[start];
+        size_t hole = start;
+        while (order[hole].second != start) {
+            const size_t from = order[hole].second;
+            data[hole] = data[from];
+            placed[hole] = true;
+            writes++;
+            hole = from;
+        }
+        data[hole] = held;
+        placed[hole] = true;
+        writes++;
+    }
+    return writes;
+}
+
+/**
+ * @brief Возвращает write_bytes из /proc/self/io: сколько байт процесс отправил на запись в хранилище.
+ * @return Количество байт или -1, если счётчик недоступен.
+ */
+long long ioWriteBytes() {
+    std::ifstream file("/proc/self/io");
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.compare(0, 12, "write_bytes:") == 0) return std::stoll(line.substr(12));
+    }
+    return -1;
+}
+
+/**
+ * @brief Режим "mmap-sort": сортирует двоичный файл билетов прямо через mmap и считает записи.
+ * @details Для каждого lottery_N.txt создаётся lottery_N.bin из TicketRecord, и каждый алгоритм
+ *          сортирует свежую копию файла на месте: std::sort и heapSort (обмены) против
+ *          cycleWalkSort (каждый элемент записывается не более одного раза). Считаются записи
+ *          элементов, испачканные страницы (их ядро обязано вернуть на диск) и прирост write_bytes
+ *          из /proc/self/io после msync (зависит от файловой системы и может быть больше грязных
+ *          страниц, а без CONFIG_TASK_IO_ACCOUNTING равен -1). С `--perturb=K` файл перед сортировкой упорядочен,
+ *          и в нём переставлены K случайных пар — типичная пересортировка слегка изменённого файла.
+ *          Результаты пишутся в "mmap_writes.txt": размер, алгоритм, записи, грязные страницы,
+ *          всего страниц, write_bytes, мс.
+ * @param cmd Аргументы: `--sizes=N,...` (по умолчанию 10 000 и 100 000), `--perturb=K`, `--seed=S`.
+ */
+void runMmapSort(const CommandLine& cmd) {
+    const auto sizes = cmd.getIntList("sizes", {10000, 100000});
+    const long long perturb = cmd.getInt("perturb", -1);
+    std::mt19937_64 rng(static_cast<uint64_t>(cmd.getInt("seed", 1)));
+
+    struct Method {
+        std::string name;
+        std::function<void(TrackedRecordIterator, size_t)> sort;
+    };
+    const std::vector<Method> methods = {
+        {"std::sort", [](TrackedRecordIterator data, size_t n) { std::sort(data, data + n, TicketRecordLess()); }},
+        {"heapSort", [](TrackedRecordIterator data, size_t n) {
+            std::make_heap(data, data + n, TicketRecordLess());
+            std::sort_heap(data, data + n, TicketRecordLess());
+        }},
+        {"cycleWalkSort", [](TrackedRecordIterator data, size_t n) { cycleWalkSort(data, n); }},
+    };
+
+    std::ofstream out("mmap_writes.txt");
+    std::cout << std::left << std::setw(10) << "size" << std::setw(15) << "algorithm" << std::right
+              << std::setw(12) << "writes" << std::setw(14) << "dirty pages" << std::setw(10) << "of"
+              << std::setw(14) << "write_bytes" << std::setw(12) << "ms" << std::endl;
+    for (long long size : sizes) {
+        const std::string dataset = "lottery_" + std::to_string(size) + ".txt";
+        const std::string binary = "lottery_" + std::to_string(size) + ".bin";
+        std::vector<TicketRecord> records;
+        for (const auto& ticket : readTicketsFromFile(dataset)) records.push_back(toTicketRecord(ticket));
+        if (perturb >= 0) {
+            std::sort(records.begin(), records.end(), [](const TicketRecord& a, const TicketRecord& b) {
+                return packTicketKey(a) < packTicketKey(b);
+            });
+            for (long long k = 0; k < perturb && records.size() > 1; k++) {
+                std::swap(records[rng() % records.size()], records[rng() % records.size()]);
+            }
+        }
+
+        for (const auto& method : methods) {
+            writeTicketRecordFile(binary, records);
+            MappedTicketFile file(binary);
+            file.sync();
+            TrackedRecordIterator data(file.data());
+            g_writeTracker.reset(file.data(), file.bytes());
+            const long long io_before = ioWriteBytes();
+            auto start = std::chrono::steady_clock::now();
+            {
+                TraceSpan span("sort", method.name + " mmap " + std::to_string(file.size()));
+                method.sort(data, file.size());
+                file.sync();
+            }
+            auto end = std::chrono::steady_clock::now();
+            const long long io_after = ioWriteBytes();
+            const long long io_bytes = io_before >= 0 && io_after >= 0 ? io_after - io_before : -1;
+            if (!std::is_sorted(file.data(), file.data() + file.size(), TicketRecordLess())) {
+                throw std::runtime_error("Result of " + method.name + " is not sorted (n = " + std::to_string(file.size()) + ")");
+            }
+            const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            std::cout << std::left << std::setw(10) << size << std::setw(15) << method.name << std::right
+                      << std::setw(12) << g_writeTracker.writes << std::setw(14) << g_writeTracker.dirtyPages()
+                      << std::setw(10) << g_writeTracker.dirty.size() << std::setw(14) << io_bytes
+                      << std::fixed << std::setprecision(3) << std::setw(12) << ms << std::endl;
+            out << size << '\t' << method.name << '\t' << g_writeTracker.writes << '\t' << g_writeTracker.dirtyPages()
+                << '\t' << g_writeTracker.dirty.size() << '\t' << io_bytes << '\t' << ms << std::endl;
+        }
+        std::remove(binary.c_str());
+    }
+}
+
+// --- Живая таблица победителей ---
+
+/**
+ * @class EpochDomain
+ * @brief Слоты эпох для отложенного освобождения памяти, которую могут ещё читать без блокировок.
+ * @details Поток при входе в критическую секцию записывает текущую эпоху в свободный слот и очищает
+ *          слот при выходе. Объект, отцепленный от структуры, откладывается с меткой advance() —
+ *          эпохой, начавшейся после отцепления. Его можно освободить, когда oldestActive() не меньше
+ *          метки: все, кто мог его видеть, вошли раньше и уже вышли.
+ */
+class EpochDomain {
+public:
+    static constexpr size_t kSlots = 256; ///< Максимум потоков одновременно в критической секции.
+
+    /**
+     * @class Guard
+     * @brief Критическая секция: пока объект жив, отложенные после входа объекты не освобождаются.
+     */
+    class Guard {
+    public:
+        /** @throws std::runtime_error Если заняты все слоты. */
+        Guard(const EpochDomain& domain, const char* owner) : slot_(domain.enter(owner)) {}
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard() { slot_->store(0); }
+
+    private:
+        std::atomic<uint64_t>* slot_;
+    };
+
+    /**
+     * @brief Занимает свободный слот текущей эпохой; освобождается записью 0.
+     * @param owner Имя структуры для сообщения об ошибке.
+     * @throws std::runtime_error Если заняты все kSlots слотов.
+     */
+    std::atomic<uint64_t>* enter(const char* owner) const {
+        const size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % kSlots;
+        for (size_t i = 0; i < kSlots; i++) {
+            auto& slot = slots_[(start + i) % kSlots].epoch;
+            uint64_t idle = 0;
+            if (slot.load(std::memory_order_relaxed) == 0 && slot.compare_exchange_strong(idle, epoch_.load())) {
+                return &slot;
+            }
+        }
+        throw std::runtime_error(std::string(owner) + ": all " + std::to_string(kSlots) + " reader slots are busy");
+    }
+
+    /** @brief Начинает новую эпоху; вызывается после отцепления объекта, результат — его метка. */
+    uint64_t advance() { return epoch_.fetch_add(1) + 1; }
+
+    /** @brief Самая старая эпоха среди занятых слотов или UINT64_MAX, если слоты свободны. */
+    uint64_t oldestActive() const {
+        uint64_t oldest = UINT64_MAX;
+        for (const auto& slot : slots_) {
+            const uint64_t epoch = slot.epoch.load();
+            if (epoch != 0) oldest = std::min(oldest, epoch);
+        }
+        return oldest;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0}; ///< Эпоха входа; 0 — слот свободен.
+    };
+
+    mutable Slot slots_[kSlots];
+    std::atomic<uint64_t> epoch_{1};
+};
+
+/**
+ * @class TicketLeaderboard
+ * @brief Конкурентная упорядоченная таблица билетов: ленивый список с пропусками (lazy skiplist).
+ * @details Порядок — LotteryTicket::operator< через упакованный ключ, так что внутри даты билеты идут
+ *          от крупных выигрышей к мелким. Вставка и удаление блокируют только узлы-предшественники
+ *          (алгоритм Херлихи — Шавита), поиск и обход не берут блокировок вообще.
+ *          Изменение выигрыша меняет ключ: новая версия билета вставляется, затем старая удаляется,
+ *          так что читатель на мгновение может увидеть обе, но никогда — ни одной.
+ *          Номер билета → текущий узел хранится в индексе из 64 шардов со своими мьютексами.
+ *          Удалённые узлы ещё могут обходить читатели, поэтому каждая операция идёт внутри
+ *          критической секции EpochDomain, а отцеплённый узел освобождается, когда из секций
+ *          вышли все, кто вошёл до его отцепления. Проверка идёт каждые kReclaimBatch удалений.
+ */
+class TicketLeaderboard {
+public:
+    TicketLeaderboard() : head_(new Node(PackedTicketKey{0, 0}, nullptr, kMaxLevel)), tail_(new Node(PackedTicketKey{0, 0}, nullptr, kMaxLevel)) {
+        for (int level = 0; level <= kMaxLevel; level++) head_->next[level].store(tail_);
+        head_->fullyLinked.store(true);
+        tail_->fullyLinked.store(true);
+    }
+
+    TicketLeaderboard(const TicketLeaderboard&) = delete;
+    TicketLeaderboard& operator=(const TicketLeaderboard&) = delete;
+
+    /** @brief Освобождает все узлы, включая удалённые. Операций к этому моменту идти не должно. */
+    ~TicketLeaderboard() {
+        for (Node* node = head_->next[0].load(); node != tail_;) {
+            Node* next = node->next[0].load();
+            delete node;
+            node = next;
+        }
+        for (auto& retired : retired_) delete retired.first;
+        delete head_;
+        delete tail_;
+    }
+
+    /**
+     * @brief Добавляет билет.
+     * @return false, если билет с таким номером уже есть.
+     */
+    bool insert(const LotteryTicket& ticket) {
+        EpochDomain::Guard epoch(epochs_, "TicketLeaderboard");
+        Shard& shard = shardOf(ticket.ticketNumber);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        if (shard.index.count(ticket.ticketNumber) != 0) return false;
+        Node* node = add(packTicketKey(ticket), ticket);
+        if (node == nullptr) return false;
+        shard.index[ticket.ticketNumber] = node;
+        size_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Меняет выигрыш билета и переставляет его на новое место.
+     * @return false, если билета нет.
+     */
+    bool updateWin(long long ticket_number, int win_amount) {
+        EpochDomain::Guard epoch(epochs_, "TicketLeaderboard");
+        Shard& shard = shardOf(ticket_number);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.index.find(ticket_number);
+        if (it == shard.index.end()) return false;
+        Node* old = it->second;
+        if (old->ticket->winAmount == win_amount) return true;
+        LotteryTicket updated = *old->ticket;
+        updated.winAmount = win_amount;
+        Node* node = add(packTicketKey(updated), updated);
+        remove(old->key);
+        it->second = node;
+        return true;
+    }
+
+    /**
+     * @brief Обходит билеты одной даты в порядке operator< (от крупных выигрышей), без блокировок.
+     * @param date Дата "YYYY-MM-DD".
+     * @param fn Вызывается для каждого билета; обход прекращается, если fn вернула false.
+     */
+    void forEachOnDate(const std::string& date, const std::function<bool(const LotteryTicket&)>& fn) const {
+        const PackedTicketKey first = packTicketFields(parseDateDays(date), std::numeric_limits<int>::max(), std::numeric_limits<long long>::min());
+        EpochDomain::Guard epoch(epochs_, "TicketLeaderboard");
+        Node* preds[kMaxLevel + 1];
+        Node* succs[kMaxLevel + 1];
+        find(first, preds, succs);
+        for (Node* node = succs[0]; node != tail_ && (node->key.hi >> 32) == (first.hi >> 32); node = node->next[0].load(std::memory_order_acquire)) {
+            if (node->marked.load(std::memory_order_acquire) || !node->fullyLinked.load(std::memory_order_acquire)) continue;
+            if (!fn(*node->ticket)) break;
+        }
+    }
+
+    /**
+     * @brief Первые limit билетов даты — крупнейшие выигрыши.
+     */
+    std::vector<LotteryTicket> topWinners(const std::string& date, size_t limit) const {
+        std::vector<LotteryTicket> result;
+        forEachOnDate(date, [&](const LotteryTicket& ticket) {
+            result.push_back(ticket);
+            return result.size() < limit;
+        });
+        return result;
+    }
+
+    /** @brief Количество билетов. */
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    /** @brief Освобождает удалённые узлы, которые больше никто не может видеть (remove делает это сам). */
+    void collect() {
+        std::lock_guard<std::mutex> guard(retiredLock_);
+        reclaim();
+    }
+
+    /** @brief Количество удалённых узлов, ожидающих выхода читателей. */
+    size_t pendingNodes() const {
+        std::lock_guard<std::mutex> guard(retiredLock_);
+        return retired_.size();
+    }
+
+    /** @brief Количество уже освобождённых узлов. */
+    size_t reclaimedNodes() const { return reclaimed_.load(); }
+
+    static constexpr size_t kReclaimBatch = 64; ///< Через сколько удалений проверять, что можно освободить.
+
+private:
+    static constexpr int kMaxLevel = 24;
+
+    struct Node {
+        Node(const PackedTicketKey& k, const LotteryTicket* t, int level)
+            : key(k), ticket(t), topLevel(level) {
+            for (auto& link : next) link.store(nullptr, std::memory_order_relaxed);
+        }
+        ~Node() { delete ticket; }
+
+        const PackedTicketKey key;
+        const LotteryTicket* ticket;
+        const int topLevel;
+        std::atomic<Node*> next[kMaxLevel + 1];
+        std::atomic<bool> marked{false};
+        std::atomic<bool> fullyLinked{false};
+        std::mutex lock;
+    };
+
+    struct Shard {
+        std::mutex lock;
+        std::unordered_map<long long, Node*> index;
+    };
+
+    Shard& shardOf(long long ticket_number) { return shards_[static_cast<uint64_t>(ticket_number) * 0x9E3779B97F4A7C15ull >> 58]; }
+
+    static int randomLevel() {
+        thread_local std::mt19937_64 rng(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        const uint64_t bits = rng();
+        int level = 0;
+        while (level < kMaxLevel && ((bits >> level) & 1) != 0) level++;
+        return level;
+    }
+
+    /** @brief Ищет предшественников и преемников key на всех уровнях; возвращает уровень, где key найден, или -1. */
+    int find(const PackedTicketKey& key, Node** preds, Node** succs) const {
+        int found = -1;
+        Node* pred = head_;
+        for (int level = kMaxLevel; level >= 0; level--) {
+            Node* curr = pred->next[level].load(std::memory_order_acquire);
+            while (curr != tail_ && curr->key < key) {
+                pred = curr;
+                curr = pred->next[level].load(std::memory_order_acquire);
+            }
+            if (found == -1 && curr != tail_ && curr->key == key) found = level;
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+        return found;
+    }
+
+    /** @brief Блокирует различных предшественников на уровнях 0..top и проверяет, что связи не изменились. */
+    static bool lockPreds(Node** preds, Node** succs, int top, std::vector<std::unique_lock<std::mutex>>& locks, bool succ_is_victim) {
+        Node* previous = nullptr;
+        for (int level = 0; level <= top; level++) {
+            Node* pred = preds[level];
+            if (pred != previous) {
+                locks.emplace_back(pred->lock);
+                previous = pred;
+            }
+            Node* succ = succs[level];
+            const bool succ_alive = succ_is_victim || !succ->marked.load(std::memory_order_acquire);
+            if (pred->marked.load(std::memory_order_acquire) || !succ_alive || pred->next[level].load(std::memory_order_acquire) != succ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Node* add(const PackedTicketKey& key, const LotteryTicket& ticket) {
+        const int top = randomLevel();
+        Node* preds[kMaxLevel + 1];
+        Node* succs[kMaxLevel + 1];
+        while (true) {
+            const int found = find(key, preds, succs);
+            if (found != -1) {
+                Node* existing = succs[found];
+                if (!existing->marked.load(std::memory_order_acquire)) {
+                    while (!existing->fullyLinked.load(std::memory_order_acquire)) std::this_thread::yield();
+                    return nullptr;
+                }
+                continue;
+            }
+            std::vector<std::unique_lock<std::mutex>> locks;
+            if (!lockPreds(preds, succs, top, locks, false)) continue;
+            Node* node = new Node(key, new LotteryTicket(ticket), top);
+            for (int level = 0; level <= top; level++) node->next[level].store(succs[level], std::memory_order_relaxed);
+            for (int level = 0; level <= top; level++) preds[level]->next[level].store(node, std::memory_order_release);
+            node->fullyLinked.store(true, std::memory_order_release);
+            return node;
+        }
+    }
+
+    bool remove(const PackedTicketKey& key) {
+        Node* victim = nullptr;
+        bool is_marked = false;
+        int top = -1;
+        Node* preds[kMaxLevel + 1];
+        Node* succs[kMaxLevel + 1];
+        std::unique_lock<std::mutex> victim_lock;
+        while (true) {
+            const int found = find(key, preds, succs);
+            if (found != -1) victim = succs[found];
+            const bool ready = found != -1 && victim->fullyLinked.load(std::memory_order_acquire) &&
+                               victim->topLevel == found && !victim->marked.load(std::memory_order_acquire);
+            if (!is_marked && !ready) return false;
+            if (!is_marked) {
+                top = victim->topLevel;
+                victim_lock = std::unique_lock<std::mutex>(victim->lock);
+                if (victim->marked.load(std::memory_order_acquire)) return false;
+                victim->marked.store(true, std::memory_order_release);
+                is_marked = true;
+            }
+            std::vector<std::unique_lock<std::mutex>> locks;
+            if (!lockPreds(preds, succs, top, locks, true)) continue;
+            for (int level = top; level >= 0; level--) {
+                preds[level]->next[level].store(victim->next[level].load(std::memory_order_acquire), std::memory_order_release);
+            }
+            {
+                std::lock_guard<std::mutex> guard(retiredLock_);
+                retired_.push_back({victim, epochs_.advance()});
+                if (retired_.size() >= kReclaimBatch) reclaim();
+            }
+            return true;
+        }
+    }
+
+    /** @brief Освобождает отцеплённые узлы, которые больше никто не может видеть. Под retiredLock_. */
+    void reclaim() {
+        const uint64_t oldest = epochs_.oldestActive();
+        auto alive = std::partition(retired_.begin(), retired_.end(), [&](const std::pair<Node*, uint64_t>& retired) {
+            return retired.second > oldest;
+        });
+        for (auto it = alive; it != retired_.end(); ++it) delete it->first;
+        reclaimed_ += static_cast<size_t>(retired_.end() - alive);
+        retired_.erase(alive, retired_.end());
+    }
+
+    Node* head_;
+    Node* tail_;
+    Shard shards_[64];
+    std::atomic<size_t> size_{0};
+    EpochDomain epochs_;
+    mutable std::mutex retiredLock_;
+    std::vector<std::pair<Node*, uint64_t>> retired_; ///< (узел, метка эпохи отцепления).
+    std::atomic<size_t> reclaimed_{0};
+};
+
+/**
+ * @brief Режим "leaderboard": пропускная способность TicketLeaderboard на смеси чтений и записей.
+ * @details Таблица заполняется --n билетами, затем --threads потоков выполняют по --ops операций:
+ *          с долей --read-share — чтение 10 крупнейших выигрышей случайной даты, остальное поровну —
+ *          вставка нового билета и изменение выигрыша существующего. Для сравнения та же нагрузка
+ *          выполняется на std::set под одним мьютексом. Результаты пишутся в "leaderboard_times.txt":
+ *          контейнер, потоки, доля чтений, млн операций/с. В конце --ops изменений выигрыша подряд
+ *          проверяют, что удалённые узлы списка освобождаются по ходу работы, а не копятся.
+ * @param cmd Аргументы: `--n=N` (по умолчанию 100 000), `--threads=T` (по умолчанию число ядер, не меньше 2),
+ *            `--ops=N` на поток (по умолчанию 100 000), `--read-share=P` в процентах (по умолчанию 20), `--seed=S`.
+ */
+void runLeaderboard(const CommandLine& cmd) {
+    const size_t n = static_cast<size_t>(std::max(1LL, cmd.getInt("n", 100000)));
+    const size_t threads = static_cast<size_t>(std::max(1LL, cmd.getInt("threads", std::max(2u, std::thread::hardware_concurrency()))));
+    const size_t ops = static_cast<size_t>(std::max(1LL, cmd.getInt("ops", 100000)));
+    const int read_share = static_cast<int>(cmd.getInt("read-share", 20));
+    const unsigned seed = static_cast<unsigned>(cmd.getInt("seed", 1));
+
+    const auto initial = generateTickets(n, seed);
+    std::vector<std::string> dates;
+    for (const auto& ticket : initial) {
+        if (std::find(dates.begin(), dates.end(), ticket.lotteryDate) == dates.end()) dates.push_back(ticket.lotteryDate);
+    }
+    const auto fresh = generateTickets(threads * ops, seed + 1);
+
+    struct Target {
+        std::string name;
+        std::function<void(const LotteryTicket&)> insert;
+        std::function<void(long long, int)> update;
+        std::function<size_t(const std::string&)> top;
+    };
+    TicketLeaderboard board;
+    std::mutex set_lock;
+    std::set<LotteryTicket> set;
+    std::unordered_map<long long, LotteryTicket> set_index;
+    const std::vector<Target> targets = {
+        {"skiplist",
+         [&](const LotteryTicket& t) { board.insert(t); },
+         [&](long long number, int win) { board.updateWin(number, win); },
+         [&](const std::string& date) { return board.topWinners(date, 10).size(); }},
+        {"std::set+mutex",
+         [&](const LotteryTicket& t) {
+             std::lock_guard<std::mutex> guard(set_lock);
+             if (set_index.emplace(t.ticketNumber, t).second) set.insert(t);
+         },
+         [&](long long number, int win) {
+             std::lock_guard<std::mutex> guard(set_lock);
+             auto it = set_index.find(number);
+             if (it == set_index.end()) return;
+             set.erase(it->second);
+             it->second.winAmount = win;
+             set.insert(it->second);
+         },
+         [&](const std::string& date) {
+             std::lock_guard<std::mutex> guard(set_lock);
+             size_t count = 0;
+             for (auto it = set.lower_bound(LotteryTicket(std::numeric_limits<long long>::min(), 0, date, std::numeric_limits<int>::max()));
+                  it != set.end() && it->lotteryDate == date && count < 10; ++it) {
+                 count++;
+             }
+             return count;
+         }},
+    };
+
+    std::ofstream out("leaderboard_times.txt");
+    for (const auto& target : targets) {
+        {
+            TraceSpan span("fill", target.name);
+            for (const auto& ticket : initial) target.insert(ticket);
+        }
+        std::atomic<size_t> rows{0};
+        auto start = std::chrono::steady_clock::now();
+        parallelFor(threads, [&](size_t t) {
+            TraceSpan span("mixed ops", target.name);
+            std::mt19937_64 rng(seed * 1000 + t);
+            size_t local_rows = 0;
+            for (size_t i = 0; i < ops; i++) {
+                const int roll = static_cast<int>(rng() % 100);
+                if (roll < read_share) {
+                    local_rows += target.top(dates[rng() % dates.size()]);
+                } else if ((roll - read_share) % 2 == 0) {
+                    target.insert(fresh[t * ops + i]);
+                } else {
+                    target.update(initial[rng() % n].ticketNumber, static_cast<int>(rng() % 100000));
+                }
+            }
+            rows += local_rows;
+        });
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double mops = threads * ops / seconds / 1e6;
+        std::cout << std::left << std::setw(16) << target.name << std::right << std::setw(4) << threads << " threads "
+                  << std::setw(4) << read_share << "% reads " << std::fixed << std::setprecision(3) << std::setw(10) << mops
+                  << " Mops/s (" << rows.load() << " rows read)" << std::endl;
+        out << target.name << '\t' << threads << '\t' << read_share << '\t' << mops << std::endl;
+    }
+
+    // Удалённые узлы должны освобождаться по ходу работы, а не копиться до деструктора
+    std::mt19937_64 rng(seed);
+    size_t peak = 0;
+    for (size_t i = 0; i < ops; i++) {
+        board.updateWin(initial[rng() % n].ticketNumber, static_cast<int>(rng() % 100000));
+        peak = std::max(peak, board.pendingNodes());
+    }
+    board.collect();
+    std::cout << "Retired skiplist nodes: " << board.reclaimedNodes() << " reclaimed, " << board.pendingNodes()
+              << " pending, peak " << peak << " during " << ops << " updates" << std::endl;
+    if (peak > TicketLeaderboard::kReclaimBatch || board.pendingNodes() != 0) {
+        throw std::runtime_error("TicketLeaderboard does not reclaim retired nodes (peak " + std::to_string(peak) + ")");
+    }
+}
+
+// --- Упорядоченный индекс билетов ---
+
+/**
+ * @class TicketBTree
+ * @brief B+-дерево в памяти над упакованными ключами билетов: ключ (дата, -выигрыш, номер) и стоимость.
+ * @details Узлы лежат в двух массивах (листья и внутренние) и ссылаются друг на друга 32-битными
+ *          индексами, а не указателями. Лист — 128 ключей и 128 стоимостей отдельными массивами
+ *          (~2.5 КБ, меньше страницы), так что поиск внутри листа — двоичный поиск по непрерывной памяти.
+ *          Внутренний узел хранит минимальный ключ и размер поддерева каждого ребёнка, поэтому
+ *          ранг и k-й элемент находятся за один спуск. Листья связаны в список для диапазонных запросов.
+ *          Загрузка из отсортированных данных — O(n) без единого разбиения узла.
+ */
+class TicketBTree {
+public:
+    static constexpr size_t kLeafCapacity = 128;  ///< Ключей в листе.
+    static constexpr size_t kInnerCapacity = 128; ///< Детей во внутреннем узле.
+
+    TicketBTree() { clear(); }
+
+    /** @brief Делает дерево пустым. */
+    void clear() {
+        leaves_.assign(1, Leaf());
+        inners_.clear();
+        root_ = 0;
+        height_ = 0;
+        size_ = 0;
+    }
+
+    /**
+     * @brief Строит дерево по отсортированным элементам за O(n).
+     * @tparam T LotteryTicket или TicketRecord.
+     * @param sorted Элементы в порядке operator< (без повторов ключа).
+     * @param fill Заполненность узлов (0..1]; запас под будущие вставки без разбиений.
+     */
+    template<typename T>
+    void bulkLoad(const std::vector<T>& sorted, double fill = 1.0) {
+        bulkLoad(sorted.data(), sorted.size(), fill);
+    }
+
+    /**
+     * @brief Строит дерево по массиву отсортированных элементов за O(n).
+     * @tparam T LotteryTicket или TicketRecord.
+     */
+    template<typename T>
+    void bulkLoad(const T* sorted, size_t n, double fill = 1.0) {
+        TraceSpan span("btree bulk load", std::to_string(n));
+        clear();
+        if (n == 0) return;
+        const size_t per_leaf = std::max<size_t>(1, std::min(kLeafCapacity, static_cast<size_t>(fill * kLeafCapacity)));
+        const size_t per_inner = std::max<size_t>(2, std::min(kInnerCapacity, static_cast<size_t>(fill * kInnerCapacity)));
+        leaves_.clear();
+        leaves_.reserve((n + per_leaf - 1) / per_leaf);
+        std::vector<Child> level;
+        for (size_t lo = 0; lo < n; lo += per_leaf) {
+            Leaf leaf;
+            leaf.count = static_cast<uint32_t>(std::min(per_leaf, n - lo));
+            for (uint32_t i = 0; i < leaf.count; i++) {
+                leaf.keys[i] = packTicketKey(sorted[lo + i]);
+                leaf.costs[i] = sorted[lo + i].cost;
+            }
+            if (!leaves_.empty()) leaves_.back().next = static_cast<uint32_t>(leaves_.size());
+            level.push_back({static_cast<uint32_t>(leaves_.size()), leaf.keys[0], leaf.count});
+            leaves_.push_back(leaf);
+        }
+        size_ = n;
+        while (level.size() > 1) {
+            std::vector<Child> parents;
+            for (size_t lo = 0, hi = 0; lo < level.size(); lo = hi) {
+                // Последний узел уровня не должен остаться с одним ребёнком
+                hi = std::min(lo + per_inner, level.size());
+                if (level.size() - hi == 1 && hi - lo > 2) hi--;
+                Inner inner;
+                uint64_t total = 0;
+                for (size_t i = lo; i < hi; i++) {
+                    inner.children[inner.count] = level[i].index;
+                    inner.keys[inner.count] = level[i].minKey;
+                    inner.sizes[inner.count] = level[i].size;
+                    inner.count++;
+                    total += level[i].size;
+                }
+                parents.push_back({static_cast<uint32_t>(inners_.size()), level[lo].minKey, total});
+                inners_.push_back(inner);
+            }
+            level.swap(parents);
+            height_++;
+        }
+        root_ = level[0].index;
+    }
+
+    /**
+     * @brief Строит дерево по отсортированному файлу билетов.
+     * @details Файл с расширением ".bin" читается как массив TicketRecord через mmap, любой другой —
+     *          как текстовый список билетов (например, sorted_lottery_N.txt из режима sort-file);
+     *          повторы ключа в текстовом файле пропускаются.
+     * @param filename Путь к файлу.
+     * @param fill Заполненность узлов (0..1].
+     * @throws std::runtime_error Если файл не открывается или билеты в нём не упорядочены.
+     */
+    void bulkLoadFile(const std::string& filename, double fill = 1.0) {
+        const bool binary = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".bin") == 0;
+        if (binary) {
+            MappedTicketFile file(filename);
+            requireSorted(file.data(), file.size(), filename);
+            bulkLoad(file.data(), file.size(), fill);
+            return;
+        }
+        auto tickets = readTicketsFromFile(filename);
+        tickets.erase(std::unique(tickets.begin(), tickets.end(), [](const LotteryTicket& a, const LotteryTicket& b) {
+            return packTicketKey(a) == packTicketKey(b);
+        }), tickets.end());
+        requireSorted(tickets.data(), tickets.size(), filename);
+        bulkLoad(tickets, fill);
+    }
+
+    /**
+     * @brief Вставляет билет.
+     * @return false, если такой ключ уже есть.
+     */
+    bool insert(const LotteryTicket& ticket) { return insert(packTicketKey(ticket), ticket.cost); }
+
+    /**
+     * @brief Вставляет ключ со стоимостью; переполненные узлы делятся пополам.
+     * @return false, если такой ключ уже есть.
+     */
+    bool insert(const PackedTicketKey& key, int cost) {
+        std::vector<std::pair<uint32_t, uint32_t>> path; // (внутренний узел, номер ребёнка)
+        uint32_t node = root_;
+        for (int level = height_; level > 0; level--) {
+            const uint32_t pos = childFor(inners_[node], key);
+            path.push_back({node, pos});
+            node = inners_[node].children[pos];
+        }
+        Leaf* leaf = &leaves_[node];
+        const uint32_t at = static_cast<uint32_t>(std::lower_bound(leaf->keys, leaf->keys + leaf->count, key) - leaf->keys);
+        if (at < leaf->count && leaf->keys[at] == key) return false;
+
+        // Вставка в лист, при переполнении — разбиение
+        bool split = false;
+        Child right{};
+        if (leaf->count == kLeafCapacity) {
+            const uint32_t new_index = static_cast<uint32_t>(leaves_.size());
+            leaves_.push_back(Leaf());
+            leaf = &leaves_[node];
+            Leaf& sibling = leaves_.back();
+            const uint32_t half = static_cast<uint32_t>(kLeafCapacity / 2);
+            sibling.count = leaf->count - half;
+            std::copy(leaf->keys + half, leaf->keys + leaf->count, sibling.keys);
+            std::copy(leaf->costs + half, leaf->costs + leaf->count, sibling.costs);
+            sibling.next = leaf->next;
+            leaf->next = new_index;
+            leaf->count = half;
+            if (at > half) {
+                insertIntoLeaf(sibling, at - half, key, cost);
+            } else {
+                insertIntoLeaf(*leaf, at, key, cost);
+            }
+            split = true;
+            right = {new_index, sibling.keys[0], sibling.count};
+        } else {
+            insertIntoLeaf(*leaf, at, key, cost);
+        }
+        size_++;
+        uint64_t left_size = leaves_[node].count;
+
+        // Подъём: размеры поддеревьев и разбиения внутренних узлов
+        for (size_t depth = path.size(); depth-- > 0;) {
+            const uint32_t index = path[depth].first, pos = path[depth].second;
+            Inner* inner = &inners_[index];
+            inner->sizes[pos]++;
+            if (pos == 0 && key < inner->keys[0]) inner->keys[0] = key;
+            if (!split) continue;
+            inner->sizes[pos] = left_size;
+            if (inner->count < kInnerCapacity) {
+                insertChild(*inner, pos + 1, right);
+                split = false;
+                continue;
+            }
+            const uint32_t new_index = static_cast<uint32_t>(inners_.size());
+            inners_.push_back(Inner());
+            inner = &inners_[index];
+            Inner& sibling = inners_.back();
+            const uint32_t half = static_cast<uint32_t>(kInnerCapacity / 2);
+            sibling.count = inner->count - half;
+            std::copy(inner->children + half, inner->children + inner->count, sibling.children);
+            std::copy(inner->keys + half, inner->keys + inner->count, sibling.keys);
+            std::copy(inner->sizes + half, inner->sizes + inner->count, sibling.sizes);
+            inner->count = half;
+            if (pos + 1 > half) {
+                insertChild(sibling, pos + 1 - half, right);
+            } else {
+                insertChild(*inner, pos + 1, right);
+            }
+            left_size = subtreeSize(*inner);
+            right = {new_index, sibling.keys[0], subtreeSize(sibling)};
+        }
+        if (split) {
+            Inner root;
+            root.count = 2;
+            root.children[0] = root_;
+            root.keys[0] = height_ == 0 ? leaves_[root_].keys[0] : inners_[root_].keys[0];
+            root.sizes[0] = left_size;
+            root.children[1] = right.index;
+            root.keys[1] = right.minKey;
+            root.sizes[1] = right.size;
+            root_ = static_cast<uint32_t>(inners_.size());
+            inners_.push_back(root);
+            height_++;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Точечный запрос.
+     * @param key Ключ.
+     * @param cost Сюда записывается стоимость найденного билета.
+     * @return true, если ключ найден.
+     */
+    bool find(const PackedTicketKey& key, int& cost) const {
+        const Leaf& leaf = leafFor(key);
+        const PackedTicketKey* it = std::lower_bound(leaf.keys, leaf.keys + leaf.count, key);
+        if (it == leaf.keys + leaf.count || *it != key) return false;
+        cost = leaf.costs[it - leaf.keys];
+        return true;
+    }
+
+    /**
+     * @brief Ранг ключа: количество ключей строго меньше key.
+     */
+    size_t rank(const PackedTicketKey& key) const {
+        size_t result = 0;
+        uint32_t node = root_;
+        for (int level = height_; level > 0; level--) {
+            const Inner& inner = inners_[node];
+            const uint32_t pos = childFor(inner, key);
+            for (uint32_t i = 0; i < pos; i++) result += inner.sizes[i];
+            node = inner.children[pos];
+        }
+        const Leaf& leaf = leaves_[node];
+        return result + static_cast<size_t>(std::lower_bound(leaf.keys, leaf.keys + leaf.count, key) - leaf.keys);
+    }
+
+    /**
+     * @brief k-й по порядку ключ (с нуля).
+     * @return false, если k >= size().
+     */
+    bool select(size_t k, PackedTicketKey& key, int& cost) const {
+        if (k >= size_) return false;
+        uint32_t node = root_;
+        for (int level = height_; level > 0; level--) {
+            const Inner& inner = inners_[node];
+            uint32_t pos = 0;
+            while (k >= inner.sizes[pos]) k -= inner.sizes[pos++];
+            node = inner.children[pos];
+        }
+        key = leaves_[node].keys[k];
+        cost = leaves_[node].costs[k];
+        return true;
+    }
+
+    /**
+     * @brief Диапазонный запрос: вызывает fn(ключ, стоимость) для всех lo <= ключ < hi по порядку.
+     * @return Количество найденных ключей.
+     */
+    size_t forEachInRange(const PackedTicketKey& lo, const PackedTicketKey& hi,
+                          const std::function<void(const PackedTicketKey&, int)>& fn) const {
+        size_t found = 0;
+        uint32_t node = leafIndexFor(lo);
+        uint32_t i = static_cast<uint32_t>(std::lower_bound(leaves_[node].keys, leaves_[node].keys + leaves_[node].count, lo) - leaves_[node].keys);
+        while (true) {
+            const Leaf& leaf = leaves_[node];
+            for (; i < leaf.count; i++) {
+                if (!(leaf.keys[i] < hi)) return found;
+                fn(leaf.keys[i], leaf.costs[i]);
+                found++;
+            }
+            if (leaf.next == kNone) return found;
+            node = leaf.next;
+            i = 0;
+        }
+    }
+
+    size_t size() const { return size_; } ///< Количество ключей.
+    int height() const { return height_; } ///< Количество уровней внутренних узлов.
+
+    /** @brief Память, занятая узлами, байт. */
+    size_t memoryBytes() const {
+        return leaves_.capacity() * sizeof(Leaf) + inners_.capacity() * sizeof(Inner);
+    }
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Leaf {
+        uint32_t count = 0;
+        uint32_t next = kNone;
+        PackedTicketKey keys[kLeafCapacity];
+        int32_t costs[kLeafCapacity];
+    };
+
+    struct Inner {
+        uint32_t count = 0;
+        uint32_t children[kInnerCapacity];
+        PackedTicketKey keys[kInnerCapacity]; ///< keys[i] — минимальный ключ поддерева children[i].
+        uint64_t sizes[kInnerCapacity];       ///< Количество ключей в поддереве children[i].
+    };
+
+    struct Child {
+        uint32_t index;
+        PackedTicketKey minKey;
+        uint64_t size;
+    };
+
+    static uint32_t childFor(const Inner& inner, const PackedTicketKey& key) {
+        const PackedTicketKey* it = std::upper_bound(inner.keys + 1, inner.keys + inner.count, key);
+        return static_cast<uint32_t>(it - inner.keys) - 1;
+    }
+
+    uint32_t leafIndexFor(const PackedTicketKey& key) const {
+        uint32_t node = root_;
+        for (int level = height_; level > 0; level--) node = inners_[node].children[childFor(inners_[node], key)];
+        return node;
+    }
+
+    const Leaf& leafFor(const PackedTicketKey& key) const { return leaves_[leafIndexFor(key)]; }
+
+    static void insertIntoLeaf(Leaf& leaf, uint32_t at, const PackedTicketKey& key, int cost) {
+        std::copy_backward(leaf.keys + at, leaf.keys + leaf.count, leaf.keys + leaf.count + 1);
+        std::copy_backward(leaf.costs + at, leaf.costs + leaf.count, leaf.costs + leaf.count + 1);
+        leaf.keys[at] = key;
+        leaf.costs[at] = cost;
+        leaf.count++;
+    }
+
+    static void insertChild(Inner& inner, uint32_t at, const Child& child) {
+        std::copy_backward(inner.children + at, inner.children + inner.count, inner.children + inner.count + 1);
+        std::copy_backward(inner.keys + at, inner.keys + inner.count, inner.keys + inner.count + 1);
+        std::copy_backward(inner.sizes + at, inner.sizes + inner.count, inner.sizes + inner.count + 1);
+        inner.children[at] = child.index;
+        inner.keys[at] = child.minKey;
+        inner.sizes[at] = child.size;
+        inner.count++;
+    }
+
+    /**
+     * @brief Проверяет, что ключи элементов строго возрастают.
+     * @throws std::runtime_error С номером первого элемента не по порядку.
+     */
+    template<typename T>
+    static void requireSorted(const T* items, size_t n, const std::string& source) {
+        for (size_t i = 1; i < n; i++) {
+            if (!(packTicketKey(items[i - 1]) < packTicketKey(items[i]))) {
+                throw std::runtime_error(source + ": ticket " + std::to_string(i) + " is out of order, expected sorted input without duplicates");
+            }
+        }
+    }
+
+    static uint64_t subtreeSize(const Inner& inner) {
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < inner.count; i++) total += inner.sizes[i];
+        return total;
+    }
+
+    std::vector<Leaf> leaves_;
+    std::vector<Inner> inners_;
+    uint32_t root_ = 0;
+    int height_ = 0;
+    size_t size_ = 0;
+};
+
+/**
+ * @brief Режим "btree": TicketBTree против std::map на наборах lottery_N.txt.
+ * @details Для каждого набора: построение (загрузка отсортированного вектора против вставок в map),
+ *          память (для map — оценка: узел красно-чёрного дерева с заголовком malloc),
+ *          точечные запросы, ранг, выборка билетов одной даты и вставка новых билетов.
+ *          Результаты пишутся в "btree_index.txt": размер, структура, операция, значение.
+ * @param cmd Аргументы: `--sizes=N,...` (по умолчанию 100 000), `--queries=Q` (по умолчанию 200 000),
+ *            `--fill=P` — заполненность узлов в процентах (по умолчанию 100),
+ *            `--from=FILE` — дополнительно построить дерево из готового отсортированного файла
+ *            (текстового sorted_*.txt или двоичного *.bin) и отчитаться о времени загрузки.
+ */
+void runBTree(const CommandLine& cmd) {
+    const auto sizes = cmd.getIntList("sizes", {100000});
+    const std::string from = cmd.get("from", "");
+    const size_t queries = static_cast<size_t>(std::max(1LL, cmd.getInt("queries", 200000)));
+    const double fill = std::min(100LL, std::max(1LL, cmd.getInt("fill", 100))) / 100.0;
+
+    std::ofstream out("btree_index.txt");
+    auto report = [&](long long size, const std::string& structure, const std::string& operation, double value, const std::string& unit) {
+        std::cout << std::left << std::setw(10) << size << std::setw(10) << structure << std::setw(14) << operation << std::right
+                  << std::fixed << std::setprecision(2) << std::setw(14) << value << " " << unit << std::endl;
+        out << size << '\t' << structure << '\t' << operation << '\t' << value << std::endl;
+    };
+    auto nsPer = [](std::chrono::steady_clock::time_point start, size_t count) {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / std::max<size_t>(count, 1);
+    };
+    for (long long size : sizes) {
+        auto tickets = readTicketsFromFile("lottery_" + std::to_string(size) + ".txt");
+        std::sort(tickets.begin(), tickets.end());
+        tickets.erase(std::unique(tickets.begin(), tickets.end(), [](const LotteryTicket& a, const LotteryTicket& b) {
+            return !(a < b) && !(b < a);
+        }), tickets.end());
+        std::vector<PackedTicketKey> keys = packTicketKeys(tickets);
+        std::mt19937_64 rng(static_cast<uint64_t>(size));
+        std::vector<PackedTicketKey> probes(queries);
+        for (auto& probe : probes) probe = keys[rng() % keys.size()];
+        const auto fresh = generateTickets(std::min<size_t>(queries, 100000), static_cast<unsigned>(size) + 1);
+
+        TicketBTree tree;
+        auto start = std::chrono::steady_clock::now();
+        tree.bulkLoad(tickets, fill);
+        report(size, "btree", "build", nsPer(start, tickets.size()), "ns/ticket");
+        std::map<PackedTicketKey, int> map;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < tickets.size(); i++) map.emplace_hint(map.end(), keys[i], tickets[i].cost);
+        report(size, "std::map", "build", nsPer(start, tickets.size()), "ns/ticket");
+
+        const size_t map_node = (32 + sizeof(std::pair<const PackedTicketKey, int>) + 8 + 15) / 16 * 16;
+        report(size, "btree", "memory", static_cast<double>(tree.memoryBytes()) / tree.size(), "bytes/ticket");
+        report(size, "std::map", "memory", static_cast<double>(map_node), "bytes/ticket (est.)");
+
+        long long checksum = 0;
+        start = std::chrono::steady_clock::now();
+        for (const auto& probe : probes) {
+            int cost = 0;
+            if (tree.find(probe, cost)) checksum += cost;
+        }
+        report(size, "btree", "point", nsPer(start, probes.size()), "ns/query");
+        start = std::chrono::steady_clock::now();
+        for (const auto& probe : probes) checksum += map.find(probe)->second;
+        report(size, "std::map", "point", nsPer(start, probes.size()), "ns/query");
+
+        start = std::chrono::steady_clock::now();
+        for (const auto& probe : probes) checksum += static_cast<long long>(tree.rank(probe));
+        report(size, "btree", "rank", nsPer(start, probes.size()), "ns/query");
+
+        const PackedTicketKey day_lo = packTicketFields(parseDateDays(tickets.front().lotteryDate), std::numeric_limits<int>::max(), std::numeric_limits<long long>::min());
+        const PackedTicketKey day_hi = packTicketFields(parseDateDays(tickets.front().lotteryDate) + 1, std::numeric_limits<int>::max(), std::numeric_limits<long long>::min());
+        start = std::chrono::steady_clock::now();
+        const size_t in_day = tree.forEachInRange(day_lo, day_hi, [&](const PackedTicketKey&, int cost) { checksum += cost; });
+        report(size, "btree", "range", nsPer(start, in_day), "ns/ticket");
+        start = std::chrono::steady_clock::now();
+        for (auto it = map.lower_bound(day_lo); it != map.end() && it->first < day_hi; ++it) checksum += it->second;
+        report(size, "std::map", "range", nsPer(start, in_day), "ns/ticket");
+
+        start = std::chrono::steady_clock::now();
+        for (const auto& ticket : fresh) tree.insert(ticket);
+        report(size, "btree", "insert", nsPer(start, fresh.size()), "ns/ticket");
+        start = std::chrono::steady_clock::now();
+        for (const auto& ticket : fresh) map.emplace(packTicketKey(ticket), ticket.cost);
+        report(size, "std::map", "insert", nsPer(start, fresh.size()), "ns/ticket");
+        if (tree.size() != map.size()) {
+            throw std::runtime_error("TicketBTree size " + std::to_string(tree.size()) + " != std::map size " + std::to_string(map.size()));
+        }
+        std::cout << "height " << tree.height() << ", checksum " << checksum << std::endl;
+    }
+    if (!from.empty()) {
+        TicketBTree tree;
+        const auto start = std::chrono::steady_clock::now();
+        tree.bulkLoadFile(from, fill);
+        report(static_cast<long long>(tree.size()), "btree", "file build", nsPer(start, tree.size()), "ns/ticket");
+        std::cout << "loaded " << from << ", height " << tree.height() << std::endl;
+    }
+}
+
+// --- Снимки для читателей ---
+
+/**
+ * @class SnapshotTicketStore
+ * @brief Отсортированное хранилище билетов с неизменяемыми версиями и освобождением по эпохам.
+ * @details Читатель закрепляет текущую версию (pin) и работает с ней без блокировок, сколько нужно:
+ *          писатель тем временем сливает новую партию в новую версию и публикует её одной атомарной
+ *          заменой указателя, так что наполовину слитых данных не видит никто.
+ *          Освобождение — по эпохам (EpochDomain): читатель при входе записывает текущую эпоху в свободный слот,
+ *          писатель после публикации увеличивает эпоху и откладывает старую версию с этой меткой.
+ *          Версия освобождается, когда ни в одном слоте не осталось эпохи меньше метки —
+ *          то есть после ухода последнего читателя, который мог её видеть.
+ */
+class SnapshotTicketStore {
+public:
+    /**
+     * @struct Snapshot
+     * @brief Неизменяемая версия хранилища.
+     */
+    struct Snapshot {
+        std::vector<LotteryTicket> tickets; ///< Билеты в порядке operator<.
+        uint64_t version;                   ///< Номер версии, начиная с 0.
+    };
+
+    /**
+     * @class Pin
+     * @brief Закреплённая версия: пока объект жив, версия не будет освобождена.
+     */
+    class Pin {
+    public:
+        Pin(Pin&& other) noexcept : slot_(other.slot_), snapshot_(other.snapshot_) { other.slot_ = nullptr; }
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+        Pin& operator=(Pin&&) = delete;
+        /** @brief Освобождает слот читателя. */
+        ~Pin() {
+            if (slot_ != nullptr) slot_->store(0);
+        }
+
+        const Snapshot& operator*() const { return *snapshot_; }   ///< Закреплённая версия.
+        const Snapshot* operator->() const { return snapshot_; }   ///< Закреплённая версия.
+
+    private:
+        friend class SnapshotTicketStore;
+        Pin(std::atomic<uint64_t>* slot, const Snapshot* snapshot) : slot_(slot), snapshot_(snapshot) {}
+
+        std::atomic<uint64_t>* slot_;
+        const Snapshot* snapshot_;
+    };
+
+    static constexpr size_t kReaderSlots = EpochDomain::kSlots; ///< Максимум одновременно закреплённых версий.
+
+    /** @brief Создаёт хранилище с начальными билетами (сортируются). */
+    explicit SnapshotTicketStore(std::vector<LotteryTicket> initial = {}) {
+        sortTickets(initial, nullptr);
+        current_.store(new Snapshot{std::move(initial), 0});
+    }
+
+    SnapshotTicketStore(const SnapshotTicketStore&) = delete;
+    SnapshotTicketStore& operator=(const SnapshotTicketStore&) = delete;
+
+    /** @brief Освобождает все версии. Закреплённых версий к этому моменту быть не должно. */
+    ~SnapshotTicketStore() {
+        delete current_.load();
+        for (auto& retired : retired_) delete retired.first;
+    }
+
+    /**
+     * @brief Закрепляет текущую версию.
+     * @throws std::runtime_error Если заняты все kReaderSlots слотов.
+     */
+    Pin pin() const {
+        std::atomic<uint64_t>* slot = epochs_.enter("SnapshotTicketStore");
+        return Pin(slot, current_.load());
+    }
+
+    /**
+     * @brief Сливает партию билетов в новую версию и публикует её; вызывается одним писателем за раз.
+     * @param batch Новые билеты в любом порядке.
+     * @return Номер опубликованной версии.
+     */
+    uint64_t ingest(std::vector<LotteryTicket> batch) {
+        std::lock_guard<std::mutex> guard(writerLock_);
+        TraceSpan span("ingest", std::to_string(batch.size()));
+        sortTickets(batch, nullptr);
+        Snapshot* old = current_.load();
+        auto* next = new Snapshot{{}, old->version + 1};
+        next->tickets.reserve(old->tickets.size() + batch.size());
+        std::merge(old->tickets.begin(), old->tickets.end(), std::make_move_iterator(batch.begin()),
+                   std::make_move_iterator(batch.end()), std::back_inserter(next->tickets));
+        current_.store(next);
+        retired_.push_back({old, epochs_.advance()});
+        reclaim();
+        return next->version;
+    }
+
+    /** @brief Освобождает версии, которые больше никто не может видеть (ingest делает это сам). */
+    void collect() {
+        std::lock_guard<std::mutex> guard(writerLock_);
+        reclaim();
+    }
+
+    /** @brief Количество версий, ожидающих ухода читателей. */
+    size_t pendingVersions() const {
+        std::lock_guard<std::mutex> guard(writerLock_);
+        return retired_.size();
+    }
+
+    /** @brief Количество уже освобождённых версий. */
+    size_t reclaimedVersions() const { return reclaimed_.load(); }
+
+private:
+    /** @brief Освобождает отложенные версии, которые больше никто не может видеть. Под writerLock_. */
+    void reclaim() {
+        const uint64_t oldest = epochs_.oldestActive();
+        auto alive = std::partition(retired_.begin(), retired_.end(), [&](const std::pair<Snapshot*, uint64_t>& retired) {
+            return retired.second > oldest;
+        });
+        for (auto it = alive; it != retired_.end(); ++it) delete it->first;
+        reclaimed_ += static_cast<size_t>(retired_.end() - alive);
+        retired_.erase(alive, retired_.end());
+    }
+
+    std::atomic<Snapshot*> current_{nullptr};
+    EpochDomain epochs_;
+    mutable std::mutex writerLock_;
+    std::vector<std::pair<Snapshot*, uint64_t>> retired_; ///< (версия, эпоха публикации следующей).
+    std::atomic<size_t> reclaimed_{0};
+};
+
+/**
+ * @brief Режим "snapshots": пропускная способность читателей во время непрерывной загрузки партий.
+ * @details Один писатель непрерывно сливает партии по --batch билетов, --readers потоков в цикле
+ *          закрепляют версию и ищут крупнейший выигрыш случайной даты. Для сравнения та же нагрузка
+ *          идёт на вектор под std::shared_mutex, куда партия вливается на месте под исключительной
+ *          блокировкой — там читатели ждут каждое слияние. Результаты пишутся в "snapshot_reads.txt":
+ *          хранилище, читатели, млн запросов/с, партий/с.
+ * @param cmd Аргументы: `--n=N` начальных билетов (по умолчанию 100 000), `--batch=B` (по умолчанию 1000),
+ *            `--readers=R` (по умолчанию 4), `--ms=T` длительность замера (по умолчанию 2000), `--seed=S`.
+ */
+void runSnapshots(const CommandLine& cmd) {
+    const size_t n = static_cast<size_t>(std::max(1LL, cmd.getInt("n", 100000)));
+    const size_t batch = static_cast<size_t>(std::max(1LL, cmd.getInt("batch", 1000)));
+    const size_t readers = static_cast<size_t>(std::max(1LL, cmd.getInt("readers", 4)));
+    const auto duration = std::chrono::milliseconds(std::max(1LL, cmd.getInt("ms", 2000)));
+    const unsigned seed = static_cast<unsigned>(cmd.getInt("seed", 1));
+
+    const auto initial = generateTickets(n, seed);
+    std::vector<std::string> dates;
+    for (const auto& ticket : initial) {
+        if (std::find(dates.begin(), dates.end(), ticket.lotteryDate) == dates.end()) dates.push_back(ticket.lotteryDate);
+    }
+    auto topWin = [](const std::vector<LotteryTicket>& tickets, const std::string& date) {
+        auto it = std::lower_bound(tickets.begin(), tickets.end(), date, [](const LotteryTicket& t, const std::string& d) {
+            return t.lotteryDate < d;
+        });
+        return it != tickets.end() && it->lotteryDate == date ? it->winAmount : -1;
+    };
+
+    struct Target {
+        std::string name;
+        std::function<void(std::vector<LotteryTicket>)> ingest;
+        std::function<int(const std::string&)> query;
+    };
+    SnapshotTicketStore store(initial);
+    std::shared_mutex rw_lock;
+    std::vector<LotteryTicket> locked(initial);
+    std::sort(locked.begin(), locked.end());
+    const std::vector<Target> targets = {
+        {"epoch snapshots",
+         [&](std::vector<LotteryTicket> tickets) { store.ingest(std::move(tickets)); },
+         [&](const std::string& date) {
+             auto snapshot = store.pin();
+             return topWin(snapshot->tickets, date);
+         }},
+        {"shared_mutex",
+         [&](std::vector<LotteryTicket> tickets) {
+             std::sort(tickets.begin(), tickets.end());
+             std::unique_lock<std::shared_mutex> guard(rw_lock);
+             const size_t middle = locked.size();
+             locked.insert(locked.end(), tickets.begin(), tickets.end());
+             std::inplace_merge(locked.begin(), locked.begin() + middle, locked.end());
+         },
+         [&](const std::string& date) {
+             std::shared_lock<std::shared_mutex> guard(rw_lock);
+             return topWin(locked, date);
+         }},
+    };
+
+    std::ofstream out("snapshot_reads.txt");
+    for (const auto& target : targets) {
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> queries{0}, batches{0};
+        std::atomic<long long> sink{0};
+        auto start = std::chrono::steady_clock::now();
+        parallelFor(readers + 1, [&](size_t t) {
+            if (t == 0) {
+                TraceSpan span("writer", target.name);
+                for (unsigned b = 0; std::chrono::steady_clock::now() - start < duration; b++) {
+                    target.ingest(generateTickets(batch, seed * 7919 + b));
+                    batches++;
+                }
+                stop = true;
+                return;
+            }
+            TraceSpan span("reader", target.name);
+            std::mt19937_64 rng(seed + t);
+            size_t local = 0;
+            long long checksum = 0;
+            while (!stop) {
+                checksum += target.query(dates[rng() % dates.size()]);
+                local++;
+            }
+            queries += local;
+            sink += checksum;
+        });
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double mqps = queries / seconds / 1e6;
+        const double bps = batches / seconds;
+        std::cout << std::left << std::setw(18) << target.name << std::right << std::setw(4) << readers << " readers "
+                  << std::fixed << std::setprecision(3) << std::setw(10) << mqps << " Mqueries/s "
+                  << std::setprecision(1) << std::setw(8) << bps << " batches/s" << std::endl;
+        out << target.name << '\t' << readers << '\t' << mqps << '\t' << bps << std::endl;
+    }
+    store.collect();
+    std::cout << "Versions reclaimed: " << store.reclaimedVersions() << ", still pending: " << store.pendingVersions() << std::endl;
+}
+
+// --- Потоковая сортировка по розыгрышам ---
+
+/**
+ * @class DrawWindowSorter
+ * @brief Потоковая сортировка: билеты копятся по открытым розыгрышам, розыгрыш сортируется
+ *        и выдаётся целиком, как только закрыт.
+ * @details Розыгрыш закрывается явно (close) или водяным знаком: при lateness >= 0 все розыгрыши
+ *          старше (самая поздняя увиденная дата - lateness дней) считаются закрытыми. Закрытие
+ *          розыгрыша закрывает и все более ранние, поэтому блоки выдаются в порядке дат
+ *          и их конкатенация совпадает с результатом глобальной сортировки. В памяти — только
+ *          открытые розыгрыши; выданный блок сразу освобождается.
+ */
+class DrawWindowSorter {
+public:
+    /**
+     * @param emit Получает отсортированный блок одного розыгрыша.
+     * @param lateness Допустимое опоздание билета в днях; -1 — без водяного знака.
+     */
+    DrawWindowSorter(std::function<void(const std::vector<LotteryTicket>&)> emit, int lateness)
+        : emit_(std::move(emit)), lateness_(lateness) {}
+
+    /**
+     * @brief Принимает билет.
+     * @throws std::runtime_error Если его розыгрыш уже закрыт и выдан.
+     */
+    void add(LotteryTicket ticket) {
+        const int day = parseDateDays(ticket.lotteryDate);
+        if (day <= closedThrough_) {
+            std::stringstream message;
+            message << "Late ticket for closed draw " << ticket.lotteryDate << ": " << ticket;
+            throw std::runtime_error(message.str());
+        }
+        open_[day].push_back(std::move(ticket));
+        buffered_++;
+        peakBuffered_ = std::max(peakBuffered_, buffered_);
+        if (lateness_ >= 0 && day > latestSeen_) {
+            latestSeen_ = day;
+            close(latestSeen_ - lateness_ - 1);
+        }
+    }
+
+    /** @brief Закрывает розыгрыш day и все более ранние: сортирует и выдаёт их по порядку дат. */
+    void close(int day) {
+        while (!open_.empty() && open_.begin()->first <= day) {
+            std::vector<LotteryTicket> block = std::move(open_.begin()->second);
+            open_.erase(open_.begin());
+            {
+                TraceSpan span("sort draw", std::to_string(block.size()));
+                sortTickets(block, nullptr);
+            }
+            buffered_ -= block.size();
+            draws_++;
+            emit_(block);
+        }
+        closedThrough_ = std::max(closedThrough_, day);
+    }
+
+    /** @brief Закрывает все оставшиеся розыгрыши (конец потока). */
+    void finish() { close(std::numeric_limits<int>::max()); }
+
+    size_t peakBuffered() const { return peakBuffered_; } ///< Наибольшее число билетов в памяти.
+    size_t draws() const { return draws_; }               ///< Выдано розыгрышей.
+
+private:
+    std::function<void(const std::vector<LotteryTicket>&)> emit_;
+    int lateness_;
+    std::map<int, std::vector<LotteryTicket>> open_;
+    int closedThrough_ = std::numeric_limits<int>::min();
+    int latestSeen_ = std::numeric_limits<int>::min();
+    size_t buffered_ = 0;
+    size_t peakBuffered_ = 0;
+    size_t draws_ = 0;
+};
+
+/**
+ * @brief Готовит поток для режима "stream" из обычного файла: розыгрыши по порядку, внутри — вперемешку,
+ *        небольшая доля билетов опаздывает в следующий розыгрыш, маркер "#close" — после опоздавших.
+ * @param input Исходный файл lottery_N.txt.
+ * @param output Файл потока.
+ * @param seed Зерно перемешивания.
+ */
+void prepareTicketStream(const std::string& input, const std::string& output, unsigned seed) {
+    auto tickets = readTicketsFromFile(input);
+    std::map<std::string, std::vector<LotteryTicket>> draws;
+    for (auto& ticket : tickets) draws[ticket.lotteryDate].push_back(std::move(ticket));
+    std::mt19937 rng(seed);
+    std::ofstream file(output);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file for writing: " + output);
+    }
+    std::vector<LotteryTicket> late;
+    std::string late_date;
+    for (auto& draw : draws) {
+        std::shuffle(draw.second.begin(), draw.second.end(), rng);
+        const size_t on_time = draw.second.size() - draw.second.size() / 100;
+        for (size_t i = 0; i < on_time; i++) {
+            file << draw.second[i] << "\n";
+            if (i == on_time / 2 && !late_date.empty()) {
+                for (const auto& ticket : late) file << ticket << "\n";
+                file << "#close " << late_date << "\n";
+                late.clear();
+            }
+        }
+        late.assign(draw.second.begin() + on_time, draw.second.end());
+        late_date = draw.first;
+    }
+    for (const auto& ticket : late) file << ticket << "\n";
+    if (!late_date.empty()) file << "#close " << late_date << "\n";
+}
+
+/**
+ * @brief Режим "stream": сортирует поток билетов по розыгрышам с ограниченной памятью.
+ * @details Строка "#close YYYY-MM-DD" закрывает розыгрыш (и все более ранние), `--lateness=D`
+ *          включает водяной знак. Каждый закрытый розыгрыш сортируется и сразу дописывается
+ *          в выходной файл; билет закрытого розыгрыша — ошибка. Печатает время до первого
+ *          розыгрыша, общее время и наибольшее число билетов в памяти.
+ * @param cmd Аргументы: `--input=файл` (по умолчанию stream_input.txt), `--output=файл`
+ *            (по умолчанию lottery_stream_sorted.txt), `--lateness=D` (по умолчанию -1 — только маркеры),
+ *            `--prepare=lottery_N.txt` — сначала собрать stream_input.txt из обычного файла, `--seed=S`.
+ */
+void runStream(const CommandLine& cmd) {
+    const std::string input = cmd.get("input", "stream_input.txt");
+    if (cmd.has("prepare")) {
+        prepareTicketStream(cmd.get("prepare", "lottery_100000.txt"), input, static_cast<unsigned>(cmd.getInt("seed", 1)));
+    }
+    const std::string output = cmd.get("output", "lottery_stream_sorted.txt");
+    std::ifstream in(input);
+    if (!in.is_open()) {
+        throw std::runtime_error("Could not open file: " + input);
+    }
+    std::ofstream out(output);
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not open file for writing: " + output);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    double first_ms = -1;
+    size_t total = 0;
+    DrawWindowSorter sorter([&](const std::vector<LotteryTicket>& block) {
+        TraceSpan span("write draw", block.empty() ? "" : block.front().lotteryDate);
+        for (const auto& ticket : block) out << ticket << "\n";
+        out.flush();
+        if (first_ms < 0) first_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  draw " << (block.empty() ? "" : block.front().lotteryDate) << ": " << block.size() << " tickets" << std::endl;
+    }, static_cast<int>(cmd.getInt("lateness", -1)));
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        if (line.compare(0, 7, "#close ") == 0) {
+            sorter.close(parseDateDays(line.substr(7)));
+            continue;
+        }
+        sorter.add(parseTicketLine(line));
+        total++;
+    }
+    sorter.finish();
+    const double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << sorter.draws() << " draws, " << total << " tickets -> " << output << std::endl;
+    std::cout << std::fixed << std::setprecision(1) << "First draw after " << first_ms << " ms, all after " << total_ms
+              << " ms; peak " << sorter.peakBuffered() << " tickets in memory ("
+              << std::setprecision(1) << (total ? 100.0 * sorter.peakBuffered() / total : 0.0) << "%)" << std::endl;
+}
+
+// --- Выдача результата по мере готовности ---
+
+/**
+ * @brief Режим "progressive": время до первой и до последней записанной строки.
+ * @details Сравниваются два способа получить отсортированный файл: std::sort и затем запись
+ *          (первая строка появляется только после всей сортировки) и progressiveSort, который пишет
+ *          строки по мере извлечения из кучи. Поток сбрасывается каждые --flush строк, чтобы
+ *          читатель на другом конце действительно их видел. Результаты пишутся в "progressive_times.txt":
+ *          размер, метод, мс до первой строки, мс до последней строки.
+ * @param cmd Аргументы: `--input=файл` (по умолчанию lottery_100000.txt), `--output=файл`
+ *            (по умолчанию lottery_progressive.txt), `--flush=N` (по умолчанию 1024), `--reps=R` (по умолчанию 3).
+ */
+void runProgressive(const CommandLine& cmd) {
+    const std::string input = cmd.get("input", "lottery_100000.txt");
+    const std::string output = cmd.get("output", "lottery_progressive.txt");
+    const size_t flush_every = static_cast<size_t>(std::max(1LL, cmd.getInt("flush", 1024)));
+    const int reps = static_cast<int>(std::max(1LL, cmd.getInt("reps", 3)));
+    const auto tickets = readTicketsFromFile(input);
+
+    struct Method {
+        std::string name;
+        std::function<void(std::vector<LotteryTicket>&, const std::function<void(const LotteryTicket&)>&)> run;
+    };
+    const std::vector<Method> methods = {
+        {"std::sort + write", [](std::vector<LotteryTicket>& arr, const std::function<void(const LotteryTicket&)>& emit) {
+            std::sort(arr.begin(), arr.end());
+            for (const auto& ticket : arr) emit(ticket);
+        }},
+        {"progressiveSort", [](std::vector<LotteryTicket>& arr, const std::function<void(const LotteryTicket&)>& emit) {
+            progressiveSort(arr, emit);
+        }},
+    };
+
+    std::ofstream results("progressive_times.txt");
+    if (!results.is_open()) {
+        throw std::runtime_error("Could not open file for writing: progressive_times.txt");
+    }
+    std::cout << tickets.size() << " tickets, best of " << reps << ":" << std::endl;
+    for (const auto& method : methods) {
+        double best_first = 0, best_last = 0;
+        for (int rep = 0; rep < reps; rep++) {
+            auto copy = copyTickets(tickets);
+            std::ofstream out(output);
+            if (!out.is_open()) {
+                throw std::runtime_error("Could not open file for writing: " + output);
+            }
+            TraceSpan span("sort", method.name + " " + std::to_string(copy.size()));
+            const auto start = std::chrono::steady_clock::now();
+            double first_ms = 0;
+            size_t rows = 0;
+            method.run(copy, [&](const LotteryTicket& ticket) {
+                out << ticket << "\n";
+                if (++rows == 1 || rows % flush_every == 0) {
+                    out.flush();
+                    if (rows == 1) first_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                }
+            });
+            out.flush();
+            const double last_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (rep == 0 || last_ms < best_last) {
+                best_first = first_ms;
+                best_last = last_ms;
+            }
+        }
+        std::cout << std::fixed << std::setprecision(2) << "  " << std::left << std::setw(20) << method.name << std::right
+                  << " first row " << std::setw(9) << best_first << " ms, last row " << std::setw(9) << best_last << " ms" << std::endl;
+        results << tickets.size() << '\t' << method.name << '\t' << best_first << '\t' << best_last << std::endl;
+    }
+}
+
+// --- Сортировка к сроку ---
+
+/**
+ * @brief Режим "deadline": какой префикс sortWithDeadline успевает отсортировать за заданный бюджет.
+ * @details Для каждого бюджета сортируются три копии набора: в исходном порядке, уже отсортированная
+ *          и отсортированная в обратном порядке (на двух последних разбиение подолгу идёт по одну сторону
+ *          от опорного). Готовый префикс сверяется с полной сортировкой, а превышение бюджета больше чем
+ *          на 10% + 1 мс помечается "OVER". Результаты пишутся в "deadline_sorts.txt": размер, порядок входа,
+ *          бюджет (мс), длина готового префикса, число оставшихся блоков, признак полной сортировки,
+ *          фактическое время (мс).
+ * @param cmd Аргументы: `--input=файл` (по умолчанию lottery_100000.txt),
+ *            `--budget-ms=B1,B2,...` (по умолчанию 1,2,5,10,20,50).
+ * @throws std::runtime_error Если префикс не совпал с полной сортировкой.
+ */
+void runDeadline(const CommandLine& cmd) {
+    const std::string input = cmd.get("input", "lottery_100000.txt");
+    const auto budgets = cmd.getIntList("budget-ms", {1, 2, 5, 10, 20, 50});
+    const auto tickets = readTicketsFromFile(input);
+    auto sorted = copyTickets(tickets);
+    std::sort(sorted.begin(), sorted.end());
+    const std::vector<std::pair<std::string, std::vector<LotteryTicket>>> layouts = {
+        {"input", tickets},
+        {"sorted", sorted},
+        {"reversed", std::vector<LotteryTicket>(sorted.rbegin(), sorted.rend())},
+    };
+
+    std::ofstream out("deadline_sorts.txt");
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not open file for writing: deadline_sorts.txt");
+    }
+    std::cout << tickets.size() << " tickets:" << std::endl;
+    for (const auto& layout : layouts) {
+        for (long long budget : budgets) {
+            auto copy = copyTickets(layout.second);
+            DeadlineSortReport report;
+            {
+                TraceSpan span("sort", "sortWithDeadline " + layout.first + " " + std::to_string(budget) + "ms");
+                report = sortWithDeadline(copy, std::chrono::milliseconds(budget));
+            }
+            if (!std::equal(copy.begin(), copy.begin() + report.sortedPrefix, sorted.begin(),
+                            [](const LotteryTicket& a, const LotteryTicket& b) { return !(a < b) && !(b < a); })) {
+                throw std::runtime_error("Prefix of sortWithDeadline is not sorted (" + layout.first + ", budget " +
+                                         std::to_string(budget) + " ms)");
+            }
+            const bool over = report.elapsedMs > budget * 1.1 + 1.0;
+            std::cout << std::fixed << std::setprecision(2) << "  " << std::left << std::setw(9) << layout.first << std::right
+                      << " budget " << std::setw(5) << budget << " ms: prefix " << std::setw(8) << report.sortedPrefix
+                      << " (" << std::setw(5) << std::setprecision(1) << 100.0 * report.sortedPrefix / std::max<size_t>(1, copy.size())
+                      << "%), " << report.partitions << " blocks left, " << std::setprecision(2) << report.elapsedMs << " ms"
+                      << (report.completed ? ", complete" : "") << (over ? "  OVER" : "") << std::endl;
+            out << copy.size() << '\t' << layout.first << '\t' << budget << '\t' << report.sortedPrefix << '\t'
+                << report.partitions << '\t' << report.completed << '\t' << report.elapsedMs << std::endl;
+        }
+    }
+}
+
+// --- Кэш результатов сортировки ---
+
+/**
+ * @brief Быстрый 64-битный хэш массива байт (по 8 байт за шаг, перемешивание в стиле splitmix64).
+ * @param data Начало данных.
+ * @param size Размер, байт.
+ * @param seed Зерно; разные зёрна дают независимые хэши.
+ * @return Хэш.
+ */
+uint64_t hashBytes(const char* data, size_t size, uint64_t seed = 0) {
+    auto mix = [](uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    };
+    uint64_t h = mix(seed ^ (size * 0x9e3779b97f4a7c15ULL));
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ mix(word)) * 0x9e3779b97f4a7c15ULL;
+        h = (h << 31) | (h >> 33);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    return mix(h ^ mix(tail ^ (size - i)));
+}
+
+/**
+ * @class SortResultCache
+ * @brief Дисковый кэш перестановок, сортирующих входной файл, с вытеснением давно не использованных.
+ * @details Ключ — хэш байтов входа и идентификатор порядка сортировки. Запись — файл
+ *          "<хэш>-<порядок>.perm" в каталоге кэша: заголовок (сигнатура, длина входа, количество строк)
+ *          и перестановка строк как uint32_t. Попадание обновляет время изменения файла, а при записи
+ *          новых результатов самые старые файлы удаляются, пока кэш не уложится в лимит. Запись идёт
+ *          во временный файл с последующим rename, поэтому параллельные процессы не видят половинчатых записей;
+ *          временные файлы упавших процессов удаляются при вытеснении. Запись, которая не является
+ *          перестановкой строк входа, считается промахом и удаляется.
+ */
+class SortResultCache {
+public:
+    /**
+     * @param dir Каталог кэша; создаётся при необходимости.
+     * @param capacityBytes Лимит суммарного размера записей.
+     */
+    SortResultCache(std::string dir, uint64_t capacityBytes) : dir_(std::move(dir)), capacity_(capacityBytes) {
+        mkdir(dir_.c_str(), 0755);
+    }
+
+    /**
+     * @brief Ищет перестановку для входа.
+     * @param hash Хэш байтов входа.
+     * @param inputBytes Длина входа — дополнительная защита от коллизий.
+     * @param order Идентификатор порядка.
+     * @param rows Ожидаемое количество строк.
+     * @param permutation Сюда кладётся найденная перестановка.
+     * @return true при попадании.
+     */
+    bool load(uint64_t hash, uint64_t inputBytes, const std::string& order, size_t rows, std::vector<uint32_t>& permutation) {
+        const std::string path = entryPath(hash, order);
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return false;
+        Header header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || std::memcmp(header.magic, kMagic, sizeof(header.magic)) != 0 || header.inputBytes != inputBytes ||
+            header.rows != rows) {
+            return false;
+        }
+        permutation.resize(rows);
+        file.read(reinterpret_cast<char*>(permutation.data()), static_cast<std::streamsize>(rows * sizeof(uint32_t)));
+        if (!file || !isPermutation(permutation)) {
+            // Обрезанная, испорченная запись или коллизия хэша: промах, запись больше не нужна
+            file.close();
+            std::remove(path.c_str());
+            return false;
+        }
+        utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+        return true;
+    }
+
+    /**
+     * @brief Сохраняет перестановку и вытесняет старые записи сверх лимита.
+     * @throws std::runtime_error Если запись не удалось сохранить.
+     */
+    void store(uint64_t hash, uint64_t inputBytes, const std::string& order, const std::vector<uint32_t>& permutation) {
+        const std::string path = entryPath(hash, order);
+        const std::string tmp = path + ".tmp" + std::to_string(getpid());
+        {
+            std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                throw std::runtime_error("Could not open file for writing: " + tmp);
+            }
+            Header header{};
+            std::memcpy(header.magic, kMagic, sizeof(header.magic));
+            header.inputBytes = inputBytes;
+            header.rows = permutation.size();
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(permutation.data()),
+                       static_cast<std::streamsize>(permutation.size() * sizeof(uint32_t)));
+            if (!file) {
+                std::remove(tmp.c_str());
+                throw std::runtime_error("Could not write file: " + tmp);
+            }
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            std::remove(tmp.c_str());
+            throw std::runtime_error("Could not write file: " + path);
+        }
+        evict();
+    }
+
+    /** @brief Суммарный размер записей в каталоге, байт. */
+    uint64_t bytes() const {
+        uint64_t total = 0;
+        for (const auto& entry : entries()) total += entry.bytes;
+        return total;
+    }
+
+private:
+    struct Header {
+        char magic[8];       ///< Сигнатура и версия формата.
+        uint64_t inputBytes; ///< Длина входа.
+        uint64_t rows;       ///< Количество строк.
+    };
+    struct Entry {
+        std::string path;
+        uint64_t bytes;
+        struct timespec used;
+    };
+    static constexpr char kMagic[8] = {'S', 'O', 'R', 'T', 'P', 'R', 'M', '1'};
+
+    /** @brief true, если каждый индекс меньше размера и встречается ровно один раз. */
+    static bool isPermutation(const std::vector<uint32_t>& permutation) {
+        std::vector<bool> seen(permutation.size(), false);
+        for (uint32_t index : permutation) {
+            if (index >= permutation.size() || seen[index]) return false;
+            seen[index] = true;
+        }
+        return true;
+    }
+
+    std::string entryPath(uint64_t hash, const std::string& order) const {
+        std::stringstream name;
+        name << dir_ << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << "-" << order << ".perm";
+        return name.str();
+    }
+
+    std::vector<Entry> entries() const {
+        std::vector<Entry> result;
+        DIR* dir = opendir(dir_.c_str());
+        if (dir == nullptr) return result;
+        while (const dirent* item = readdir(dir)) {
+            const std::string name = item->d_name;
+            if (name.size() < 5 || name.compare(name.size() - 5, 5, ".perm") != 0) continue;
+            struct stat st{};
+            const std::string path = dir_ + "/" + name;
+            if (stat(path.c_str(), &st) != 0) continue;
+#ifdef __APPLE__
+            result.push_back({path, static_cast<uint64_t>(st.st_size), st.st_mtimespec});
+#else
+            result.push_back({path, static_cast<uint64_t>(st.st_size), st.st_mtim});
+#endif
+        }
+        closedir(dir);
+        return result;
+    }
+
+    /** @brief Удаляет временные файлы store(), оставшиеся от завершившихся (упавших) процессов. */
+    void removeStaleTemporaries() const {
+        DIR* dir = opendir(dir_.c_str());
+        if (dir == nullptr) return;
+        std::vector<std::string> stale;
+        while (const dirent* item = readdir(dir)) {
+            const std::string name = item->d_name;
+            const size_t at = name.rfind(".perm.tmp");
+            if (at == std::string::npos) continue;
+            const std::string digits = name.substr(at + 9);
+            if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) continue;
+            const pid_t owner = static_cast<pid_t>(std::stol(digits));
+            if (owner != getpid() && kill(owner, 0) != 0 && errno == ESRCH) stale.push_back(dir_ + "/" + name);
+        }
+        closedir(dir);
+        for (const auto& path : stale) std::remove(path.c_str());
+    }
+
+    void evict() {
+        removeStaleTemporaries();
+        auto all = entries();
+        uint64_t total = 0;
+        for (const auto& entry : all) total += entry.bytes;
+        std::sort(all.begin(), all.end(), [](const Entry& a, const Entry& b) {
+            return std::tie(a.used.tv_sec, a.used.tv_nsec) < std::tie(b.used.tv_sec, b.used.tv_nsec);
+        });
+        // Самая свежая запись остаётся, даже если одна превышает лимит
+        for (size_t i = 0; i + 1 < all.size() && total > capacity_; i++) {
+            if (std::remove(all[i].path.c_str()) == 0) total -= all[i].bytes;
+        }
+    }
+
+    std::string dir_;
+    uint64_t capacity_;
+};
+
+constexpr char SortResultCache::kMagic[8];
+
+/**
+ * @brief Режим "sort-file": сортирует текстовый файл билетов, переиспользуя результаты прошлых запусков.
+ * @details Вход читается целиком и хэшируется; при попадании в кэш перестановка строк берётся с диска,
+ *          и разбор с сортировкой пропускаются — остаётся только ввод-вывод. Порядки: "tickets" —
+ *          operator< (дата, -выигрыш, номер), "prize" — устойчиво по (дате, -выигрышу). Режимы сравнения
+ *          алгоритмов кэш не используют.
+ * @param cmd Аргументы: `--input=файл` (по умолчанию lottery_100000.txt), `--output=файл`
+ *            (по умолчанию sorted_<вход>), `--order=tickets|prize`, `--no-cache`,
+ *            `--cache-dir=каталог` (по умолчанию .sort_cache), `--cache-mb=M` (по умолчанию 256).
+ * @throws std::runtime_error При неизвестном порядке или ошибках ввода-вывода.
+ */
+void runSortFile(const CommandLine& cmd) {
+    const std::string input = cmd.get("input", "lottery_100000.txt");
+    const std::string output = cmd.get("output", "sorted_" + input.substr(input.find_last_of('/') + 1));
+    const std::string order = cmd.get("order", "tickets");
+    if (order != "tickets" && order != "prize") {
+        throw std::runtime_error("Unknown sort order: " + order);
+    }
+    const bool use_cache = !cmd.has("no-cache");
+    auto elapsed = [](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    };
+
+    auto stage = std::chrono::steady_clock::now();
+    std::string bytes;
+    {
+        TraceSpan span("read input", input);
+        std::ifstream file(input, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open file: " + input);
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        bytes = buffer.str();
+    }
+    std::vector<std::pair<size_t, size_t>> lines; // [начало, конец) каждой непустой строки без "\r\n"
+    for (size_t pos = 0; pos < bytes.size();) {
+        size_t end = bytes.find('\n', pos);
+        if (end == std::string::npos) end = bytes.size();
+        size_t stop = end;
+        if (stop > pos && bytes[stop - 1] == '\r') stop--;
+        if (stop > pos) lines.emplace_back(pos, stop);
+        pos = end + 1;
+    }
+    if (lines.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Too many lines for the sort cache: " + input);
+    }
+    const double read_ms = elapsed(stage);
+
+    stage = std::chrono::steady_clock::now();
+    const uint64_t hash = hashBytes(bytes.data(), bytes.size());
+    const double hash_ms = elapsed(stage);
+
+    stage = std::chrono::steady_clock::now();
+    SortResultCache cache(cmd.get("cache-dir", ".sort_cache"),
+                          static_cast<uint64_t>(std::max(1LL, cmd.getInt("cache-mb", 256))) << 20);
+    std::vector<uint32_t> permutation;
+    const bool hit = use_cache && cache.load(hash, bytes.size(), order, lines.size(), permutation);
+    if (!hit) {
+        TraceSpan span("sort", order + " " + std::to_string(lines.size()));
+        std::vector<LotteryTicket> tickets;
+        tickets.reserve(lines.size());
+        for (const auto& line : lines) tickets.push_back(parseTicketLine(bytes.substr(line.first, line.second - line.first)));
+        permutation.resize(tickets.size());
+        for (size_t i = 0; i < permutation.size(); i++) permutation[i] = static_cast<uint32_t>(i);
+        if (order == "tickets") {
+            std::stable_sort(permutation.begin(), permutation.end(),
+                             [&](uint32_t a, uint32_t b) { return tickets[a] < tickets[b]; });
+        } else {
+            const PrizeTierLess less;
+            std::stable_sort(permutation.begin(), permutation.end(),
+                             [&](uint32_t a, uint32_t b) { return less(tickets[a], tickets[b]); });
+        }
+        if (use_cache) cache.store(hash, bytes.size(), order, permutation);
+    }
+    const double sort_ms = elapsed(stage);
+
+    stage = std::chrono::steady_clock::now();
+    {
+        TraceSpan span("write output", output);
+        std::ofstream file(output, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open file for writing: " + output);
+        }
+        for (uint32_t index : permutation) {
+            file.write(bytes.data() + lines[index].first, static_cast<std::streamsize>(lines[index].second - lines[index].first));
+            file.put('\n');
+        }
+    }
+    const double write_ms = elapsed(stage);
+
+    std::cout << lines.size() << " tickets, order " << order << " -> " << output << " ("
+              << (!use_cache ? "cache off" : hit ? "cache hit" : "cache miss") << ")" << std::endl;
+    std::cout << std::fixed << std::setprecision(2) << "  read " << read_ms << " ms, hash " << hash_ms << " ms, "
+              << (hit ? "load " : "sort ") << sort_ms << " ms, write " << write_ms << " ms" << std::endl;
+    if (use_cache) {
+        std::cout << "  cache " << std::setprecision(1) << cache.bytes() / 1048576.0 << " MiB" << std::endl;
+    }
+}
+
+// --- Набор данных в разделяемой памяти ---
+
+/**
+ * @struct SharedDatasetHeader
+ * @brief Заголовок сегмента разделяемой памяти с набором билетов; за ним следуют count записей TicketRecord.
+ * @details Сигнатура записывается последней, поэтому процесс, подключившийся во время загрузки,
+ *          увидит неготовый сегмент, а не половину данных.
+ */
+struct SharedDatasetHeader {
+    char magic[8];    ///< "TICKSHM1", когда данные полностью записаны.
+    uint64_t count;   ///< Количество записей.
+    char source[112]; ///< Имя исходного файла (для диагностики).
+};
+
+static_assert(sizeof(SharedDatasetHeader) % alignof(TicketRecord) == 0, "records must stay aligned after the header");
+
+constexpr char kSharedDatasetMagic[8] = {'T', 'I', 'C', 'K', 'S', 'H', 'M', '1'};
+
+/**
+ * @brief Имя сегмента по умолчанию для файла: "/lottery_N" для "lottery_N.txt".
+ */
+std::string sharedDatasetName(const std::string& input) {
+    std::string base = input.substr(input.find_last_of('/') + 1);
+    if (base.size() > 4 && base.compare(base.size() - 4, 4, ".txt") == 0) base.resize(base.size() - 4);
+    return "/" + base;
+}
+
+/**
+ * @brief Загружает набор билетов в именованный сегмент POSIX shm, заменяя прежний сегмент с тем же именем.
+ * @param name Имя сегмента ("/имя").
+ * @param source Имя исходного файла, сохраняется в заголовке.
+ * @param records Записи.
+ * @throws std::runtime_error Если имя файла не помещается в заголовок или сегмент не удалось создать или отобразить.
+ */
+void loadSharedDataset(const std::string& name, const std::string& source, const std::vector<TicketRecord>& records) {
+    TraceSpan span("shm load", name);
+    if (source.size() >= sizeof(SharedDatasetHeader::source)) {
+        throw std::runtime_error("Source path does not fit the shared dataset header (max " +
+                                 std::to_string(sizeof(SharedDatasetHeader::source) - 1) + " bytes): " + source);
+    }
+    const size_t bytes = sizeof(SharedDatasetHeader) + records.size() * sizeof(TicketRecord);
+    shm_unlink(name.c_str());
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not create shared memory segment: " + name);
+    }
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Could not size shared memory segment: " + name);
+    }
+    void* data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Could not map shared memory segment: " + name);
+    }
+    auto* header = static_cast<SharedDatasetHeader*>(data);
+    header->count = records.size();
+    std::snprintf(header->source, sizeof(header->source), "%s", source.c_str());
+    if (!records.empty()) {
+        std::memcpy(static_cast<char*>(data) + sizeof(SharedDatasetHeader), records.data(), records.size() * sizeof(TicketRecord));
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, kSharedDatasetMagic, sizeof(header->magic));
+    munmap(data, bytes);
+}
+
+/**
+ * @class SharedTicketDataset
+ * @brief Набор билетов из сегмента разделяемой памяти, подключённый копированием при записи (MAP_PRIVATE).
+ * @details Подключение не читает и не разбирает данные: страницы общие для всех процессов, пока их
+ *          только читают. Запись (например, сортировка на месте) копирует затронутые страницы в память
+ *          процесса, сам сегмент и другие процессы изменений не видят.
+ */
+class SharedTicketDataset {
+public:
+    /**
+     * @brief Подключает сегмент.
+     * @param name Имя сегмента ("/имя").
+     * @throws std::runtime_error Если сегмента нет, он не отображается или ещё не загружен до конца.
+     */
+    explicit SharedTicketDataset(const std::string& name) {
+        const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open shared memory segment: " + name + " (run shm-load first)");
+        }
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SharedDatasetHeader)) {
+            close(fd);
+            throw std::runtime_error("Not a ticket dataset segment: " + name);
+        }
+        bytes_ = static_cast<size_t>(st.st_size);
+        void* data = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Could not map shared memory segment: " + name);
+        }
+        base_ = data;
+        const auto* header = static_cast<const SharedDatasetHeader*>(base_);
+        if (std::memcmp(header->magic, kSharedDatasetMagic, sizeof(header->magic)) != 0 ||
+            sizeof(SharedDatasetHeader) + header->count * sizeof(TicketRecord) != bytes_) {
+            munmap(base_, bytes_);
+            throw std::runtime_error("Shared memory segment is not a complete ticket dataset: " + name);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    SharedTicketDataset(const SharedTicketDataset&) = delete;
+    SharedTicketDataset& operator=(const SharedTicketDataset&) = delete;
+
+    /** @brief Отключает сегмент; личные копии страниц освобождаются. */
+    ~SharedTicketDataset() { munmap(base_, bytes_); }
+
+    /** @brief Первая запись; изменения видит только этот процесс. */
+    TicketRecord* data() { return reinterpret_cast<TicketRecord*>(static_cast<char*>(base_) + sizeof(SharedDatasetHeader)); }
+    /** @brief Количество записей. */
+    size_t size() const { return static_cast<const SharedDatasetHeader*>(base_)->count; }
+    /** @brief Имя исходного файла. */
+    std::string source() const { return static_cast<const SharedDatasetHeader*>(base_)->source; }
+
+private:
+    void* base_ = nullptr;
+    size_t bytes_ = 0;
+};
+
+/**
+ * @brief Режим "shm-load": разбирает файл один раз и кладёт записи в сегмент разделяемой памяти.
+ * @param cmd Аргументы: `--input=файл` (по умолчанию lottery_100000.txt), `--name=/имя` (по умолчанию "/lottery_N").
+ */
+void runShmLoad(const CommandLine& cmd) {
+    const std::string input = cmd.get("input", "lottery_100000.txt");
+    const std::string name = cmd.get("name", sharedDatasetName(input));
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<TicketRecord> records;
+    for (const auto& ticket : readTicketsFromFile(input)) records.push_back(toTicketRecord(ticket));
+    loadSharedDataset(name, input, records);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << records.size() << " tickets from " << input << " -> shm " << name << " ("
+              << (sizeof(SharedDatasetHeader) + records.size() * sizeof(TicketRecord)) / 1024 << " KiB, "
+              << std::fixed << std::setprecision(2) << ms << " ms)" << std::endl;
+}
+
+/**
+ * @brief Режим "shm-attach": время запуска рабочего процесса с подключением к сегменту против разбора файла.
+ * @details Родитель порождает --workers процессов (fork, как при запуске задания). Каждый сначала
+ *          разбирает исходный текстовый файл, затем подключает сегмент и сортирует свою копию на месте;
+ *          в конце хэш записей сегмента сверяется со снятым до запуска, то есть сортировки шли в личных копиях.
+ * @param cmd Аргументы: `--name=/имя` (по умолчанию "/lottery_100000"), `--workers=W` (по умолчанию 4).
+ * @throws std::runtime_error Если сегмента нет или рабочий процесс завершился с ошибкой.
+ */
+void runShmAttach(const CommandLine& cmd) {
+    const std::string name = cmd.get("name", "/lottery_100000");
+    const int workers = static_cast<int>(std::max(1LL, cmd.getInt("workers", 4)));
+    std::string source;
+    uint64_t records_hash;
+    {
+        SharedTicketDataset probe(name);
+        source = probe.source();
+        records_hash = hashBytes(reinterpret_cast<const char*>(probe.data()), probe.size() * sizeof(TicketRecord));
+    }
+    std::cout << "segment " << name << " (" << source << "), " << workers << " workers:" << std::endl;
+    std::cout.flush();
+
+    for (int w = 0; w < workers; w++) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error("fork failed");
+        }
+        if (pid > 0) {
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                throw std::runtime_error("Worker " + std::to_string(w) + " failed");
+            }
+            continue;
+        }
+        int code = 0;
+        try {
+            auto start = std::chrono::steady_clock::now();
+            const auto parsed = readTicketsFromFile(source);
+            const double parse_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            start = std::chrono::steady_clock::now();
+            SharedTicketDataset dataset(name);
+            const double attach_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            start = std::chrono::steady_clock::now();
+            std::sort(dataset.data(), dataset.data() + dataset.size(), [](const TicketRecord& a, const TicketRecord& b) {
+                return packTicketKey(a) < packTicketKey(b);
+            });
+            const double sort_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << std::fixed << std::setprecision(2) << "  worker " << w << ": parse " << parsed.size() << " tickets "
+                      << std::setw(8) << parse_ms << " ms, attach " << dataset.size() << " " << std::setw(6) << attach_ms
+                      << " ms, private sort " << std::setw(7) << sort_ms << " ms" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "worker " << w << ": " << e.what() << std::endl;
+            code = 1;
+        }
+        std::cout.flush();
+        _exit(code);
+    }
+
+    SharedTicketDataset after(name);
+    const bool unchanged = hashBytes(reinterpret_cast<const char*>(after.data()), after.size() * sizeof(TicketRecord)) == records_hash;
+    std::cout << "segment " << (unchanged ? "unchanged" : "CHANGED")
+              << " by worker sorts" << std::endl;
+}
+
+/**
+ * @brief Режим "shm-unlink": удаляет сегмент; уже подключённые процессы продолжают работать со своими отображениями.
+ * @param cmd Аргументы: `--name=/имя` (по умолчанию "/lottery_100000").
+ * @throws std::runtime_error Если сегмента нет.
+ */
+void runShmUnlink(const CommandLine& cmd) {
+    const std::string name = cmd.get("name", "/lottery_100000");
+    if (shm_unlink(name.c_str()) != 0) {
+        throw std::runtime_error("Could not unlink shared memory segment: " + name);
+    }
+    std::cout << "unlinked " << name << std::endl;
+}
+
+// --- Настройка под машину ---
+
+/**
+ * @brief Возвращает имя текущего хоста (секция файла настроек).
+ */
+std::string hostName() {
+    char buf[256] = {0};
+    if (gethostname(buf, sizeof(buf) - 1) != 0 || buf[0] == '\0') return "unknown";
+    return buf;
+}
+
+/**
+ * @brief Читает файл настроек: секции `[хост]` и строки `ключ=значение`, `#` — комментарий.
+ * @param filename Имя файла.
+ * @return Настройки по хостам; пустой словарь, если файла нет.
+ */
+std::map<std::string, std::map<std::string, std::string>> readTuningFile(const std::string& filename) {
+    std::map<std::string, std::map<std::string, std::string>> hosts;
+    std::ifstream file(filename);
+    std::string line, host;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        if (line.front() == '[' && line.back() == ']') {
+            host = line.substr(1, line.size() - 2);
+            hosts[host];
+            continue;
+        }
+        auto eq = line.find('=');
+        if (eq != std::string::npos && !host.empty()) {
+            hosts[host][line.substr(0, eq)] = line.substr(eq + 1);
+        }
+    }
+    return hosts;
+}
+
+/**
+ * @brief Переводит параметры в пары ключ-значение для файла настроек.
+ */
+std::map<std::string, std::string> tuningToMap(const SortTuning& tuning) {
+    return {
+        {"insertionCutoff", std::to_string(tuning.insertionCutoff)},
+        {"radixDigitBits", std::to_string(tuning.radixDigitBits)},
+        {"parallelGrain", std::to_string(tuning.parallelGrain)},
+        {"threads", std::to_string(tuning.threads)},
+        {"radixMinSize", std::to_string(tuning.radixMinSize)},
+        {"heapArity", std::to_string(tuning.heapArity)},
+    };
+}
+
+/**
+ * @brief Применяет пары ключ-значение к параметрам; неизвестные ключи игнорируются.
+ * @details radixDigitBits приводится к диапазону 4-16, heapArity — не меньше 2.
+ * @throws std::runtime_error Если значение не является неотрицательным целым числом.
+ */
+void applyTuningMap(const std::map<std::string, std::string>& values, SortTuning& tuning) {
+    for (const auto& entry : values) {
+        const std::string& text = entry.second;
+        size_t pos = 0;
+        unsigned long long value = 0;
+        const size_t first = text.find_first_not_of(" \t");
+        bool ok = first != std::string::npos && text[first] != '-' && text[first] != '+';
+        if (ok) {
+            try {
+                value = std::stoull(text, &pos);
+            } catch (const std::exception&) {
+                ok = false;
+            }
+        }
+        if (!ok || text.find_first_not_of(" \t", pos) != std::string::npos ||
+            (entry.first == "threads" && value > std::numeric_limits<unsigned>::max())) {
+            throw std::runtime_error("Bad tuning value " + entry.first + "=" + entry.second);
+        }
+        if (entry.first == "insertionCutoff") tuning.insertionCutoff = value;
+        else if (entry.first == "radixDigitBits") tuning.radixDigitBits = static_cast<int>(std::clamp<unsigned long long>(value, 4, 16));
+        else if (entry.first == "parallelGrain") tuning.parallelGrain = value;
+        else if (entry.first == "threads") tuning.threads = static_cast<unsigned>(value);
+        else if (entry.first == "radixMinSize") tuning.radixMinSize = value;
+        else if (entry.first == "heapArity") tuning.heapArity = std::max<unsigned long long>(value, 2);
+    }
+}
+
+/**
+ * @brief Загружает параметры текущего хоста из файла настроек в g_sortTuning.
+ * @param filename Имя файла.
+ * @return true, если для хоста нашлась секция.
+ */
+bool loadSortTuning(const std::string& filename) {
+    auto hosts = readTuningFile(filename);
+    auto it = hosts.find(hostName());
+    if (it == hosts.end()) return false;
+    applyTuningMap(it->second, g_sortTuning);
+    return true;
+}
+
+/**
+ * @brief Сохраняет параметры текущего хоста, не трогая секции других хостов.
+ * @param filename Имя файла.
+ * @param tuning Параметры.
+ * @throws std::runtime_error Если не удалось открыть файл для записи.
+ */
+void saveSortTuning(const std::string& filename, const SortTuning& tuning) {
+    auto hosts = readTuningFile(filename);
+    hosts[hostName()] = tuningToMap(tuning);
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not open file for writing: " + filename);
+    }
+    out << "# Sort engine tuning per host, written by 'main autotune'\n";
+    for (const auto& host : hosts) {
+        out << "[" << host.first << "]\n";
+        for (const auto& entry : host.second) {
+            out << entry.first << "=" << entry.second << "\n";
+        }
+    }
+}
+
+/**
+ * @brief Подбирает одно значение параметра: замеряет алгоритм при каждом кандидате.
+ * @tparam Value Тип параметра.
+ * @param knob Имя параметра для отчёта.
+ * @param field Ссылка на параметр в g_sortTuning.
+ * @param candidates Кандидаты.
+ * @param engine_name Имя алгоритма из реестра, на котором идёт замер.
+ * @param data Данные для замера.
+ */
+template<typename Value>
+void tuneKnob(const std::string& knob, Value& field, const std::vector<Value>& candidates,
+              const std::string& engine_name, const std::vector<LotteryTicket>& data) {
+    SortEngine<LotteryTicket> engine;
+    for (auto& e : sortEngines<LotteryTicket>()) {
+        if (e.name == engine_name) engine = e;
+    }
+    Value best = field;
+    double best_ns = -1;
+    std::cout << knob << " (" << engine_name << "):";
+    for (Value candidate : candidates) {
+        field = candidate;
+        TraceSpan span("autotune", knob + "=" + std::to_string(candidate));
+        double ns = measureNsPerElement(engine, data, 100.0);
+        std::cout << " " << candidate << "->" << std::fixed << std::setprecision(1) << ns;
+        if (best_ns < 0 || ns < best_ns) {
+            best_ns = ns;
+            best = candidate;
+        }
+    }
+    field = best;
+    std::cout << " ns/elem, best " << best << std::endl;
+}
+
+/**
+ * @brief Ищет размер, начиная с которого radixSort быстрее std::sort.
+ * @param data Данные; используются префиксы разных размеров.
+ * @return Наименьший размер из проверенных, где radixSort выиграл у std::sort.
+ */
+size_t calibrateRadixMinSize(const std::vector<LotteryTicket>& data) {
+    SortEngine<LotteryTicket> radix{"radixSort", [](std::vector<LotteryTicket>& a) { radixSort(a); }, false};
+    SortEngine<LotteryTicket> introsort{"std::sort", [](std::vector<LotteryTicket>& a) { std::sort(a.begin(), a.end()); }, false};
+    std::cout << "radixMinSize:";
+    for (size_t n = 128; n <= std::min<size_t>(data.size(), 65536); n *= 2) {
+        std::vector<LotteryTicket> prefix(data.begin(), data.begin() + n);
+        double radix_ns = measureNsPerElement(radix, prefix, 50.0);
+        double sort_ns = measureNsPerElement(introsort, prefix, 50.0);
+        std::cout << " " << n << ":" << std::fixed << std::setprecision(1) << radix_ns << "/" << sort_ns;
+        if (radix_ns < sort_ns) {
+            std::cout << " -> " << n << std::endl;
+            return n;
+        }
+    }
+    std::cout << " -> radix never won" << std::endl;
+    return std::numeric_limits<size_t>::max();
+}
+
+/**
+ * @brief Режим "autotune": подбирает параметры алгоритмов для этой машины и сохраняет их.
+ * @details Параметры подбираются по очереди на синтетических билетах (generateTickets),
+ *          остальные при этом остаются текущими лучшими. Результат записывается в секцию
+ *          текущего хоста файла настроек, который main читает при каждом запуске.
+ * @param cmd Аргументы: `--n=N` (по умолчанию 200 000), `--tuning=файл` (по умолчанию "sort_tuning.cfg"),
+ *            `--seed=S`.
+ */
+void runAutotune(const CommandLine& cmd) {
+    const size_t n = static_cast<size_t>(std::max(1000LL, cmd.getInt("n", 200000)));
+    const std::string filename = cmd.get("tuning", "sort_tuning.cfg");
+    std::vector<LotteryTicket> data;
+    {
+        TraceSpan span("generate", std::to_string(n));
+        data = generateTickets(n, static_cast<unsigned>(cmd.getInt("seed", 1)));
+    }
+    std::cout << "Autotuning on " << n << " synthetic tickets, host " << hostName() << std::endl;
+
+    tuneKnob<size_t>("insertionCutoff", g_sortTuning.insertionCutoff, {8, 16, 24, 32, 48, 64}, "naturalMergeSort", data);
+    tuneKnob<int>("radixDigitBits", g_sortTuning.radixDigitBits, {4, 6, 8, 11, 16}, "radixSort", data);
+    tuneKnob<size_t>("heapArity", g_sortTuning.heapArity, {2, 3, 4, 6, 8}, "dAryHeapSort", data);
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> thread_candidates;
+    for (unsigned t = 1; t < cores; t *= 2) thread_candidates.push_back(t);
+    thread_candidates.push_back(cores);
+    tuneKnob<unsigned>("threads", g_sortTuning.threads, thread_candidates, "parallelSort", data);
+    std::vector<size_t> grains;
+    for (size_t grain = 4096; grain <= std::max<size_t>(n / 2, 4096); grain *= 4) grains.push_back(grain);
+    tuneKnob<size_t>("parallelGrain", g_sortTuning.parallelGrain, grains, "parallelSort", data);
+
+    g_sortTuning.radixMinSize = calibrateRadixMinSize(data);
+
+    saveSortTuning(filename, g_sortTuning);
+    std::cout << "Saved to " << filename << " [" << hostName() << "]" << std::endl;
+}
+
+/**
+ * @brief Выводит краткую справку по режимам.
+ */
+void printUsage() {
+    std::cout << "Usage: main [mode] [options]\n"
+              << "  (no mode)  benchmark of all algorithms on lottery_N.txt -> time_sorts.txt\n"
+              << "  sweep      ns/element around each cache boundary -> cache_sweep.txt\n"
+              << "  coldwarm   sorts on cache-resident vs evicted data -> cold_warm.txt\n"
+              << "  energy     joules per sort from RAPL counters -> energy_sorts.txt\n"
+              << "  engines    every registered engine on lottery_N.txt -> engine_times.txt\n"
+              << "  synth      every registered engine on synthetic profiles -> synth_times.txt\n"
+              << "  autotune   calibrate engine thresholds for this host -> sort_tuning.cfg\n"
+              << "  numa       parallel sorts with local/remote memory access ratios -> numa_sorts.txt\n"
+              << "  leaderboard concurrent ordered ticket table under mixed reads/writes -> leaderboard_times.txt\n"
+              << "  btree      bulk-loaded B+tree index vs std::map (--from=sorted_<input> loads a sorted file) -> btree_index.txt\n"
+              << "  snapshots  reader throughput during continuous batch ingestion -> snapshot_reads.txt\n"
+              << "  shm-load   parse --input once into a POSIX shared memory segment (--name=/lottery_N)\n"
+              << "  shm-attach fork --workers that attach the segment copy-on-write and sort it privately\n"
+              << "  shm-unlink remove the shared memory segment --name\n"
+              << "  sort-file  sort --input with an on-disk result cache (--no-cache to bypass) -> sorted_<input>\n"
+              << "  deadline   sorted prefix reached by sortWithDeadline per --budget-ms -> deadline_sorts.txt\n"
+              << "  progressive time to first/last written row: std::sort vs progressiveSort -> progressive_times.txt\n"
+              << "  stream     per-draw streaming sort with #close markers/watermark -> lottery_stream_sorted.txt\n"
+              << "  mmap-sort  element writes and dirty pages of in-place sorts on a mapped file -> mmap_writes.txt\n"
+              << "Common options: --trace[=file], --tuning=file (default sort_tuning.cfg)\n";
+}
+
+/**
+ * @brief Главная функция программы.
+ * @details Разбирает аргументы, запускает выбранный режим и при необходимости сохраняет трассу.
+ * @param argc Количество аргументов.
+ * @param argv Режим и опции: `--trace[=файл]` — записать трассу этапов (по умолчанию "trace.json"),
+ *             `--quadratic-limit=N` — не запускать O(n²)-сортировки на наборах больше N.
+ * @return 0 в случае успешного выполнения, 1 при неизвестном режиме.
+ */
+int main(int argc, char* argv[]){
+    CommandLine cmd = parseCommandLine(argc, argv);
+    if (cmd.has("trace")) {
+        g_traceEnabled = true;
+    }
+    if (loadSortTuning(cmd.get("tuning", "sort_tuning.cfg"))) {
+        std::clog << "Loaded sort tuning for " << hostName() << std::endl;
+    }
+
+    const std::string mode = cmd.positional.empty() ? "" : cmd.positional[0];
+    {
+        TraceSpan span("run", mode);
+        if (mode.empty()) {
+            runBenchmark(cmd);
+        } else if (mode == "sweep") {
+            runCacheSweep(cmd);
+        } else if (mode == "coldwarm") {
+            runColdWarm(cmd);
+        } else if (mode == "energy") {
+            runEnergy(cmd);
+        } else if (mode == "engines") {
+            runEngines(cmd);
+        } else if (mode == "synth") {
+            runSynthetic(cmd);
+        } else if (mode == "autotune") {
+            runAutotune(cmd);
+        } else if (mode == "numa") {
+            runNuma(cmd);
+        } else if (mode == "leaderboard") {
+            runLeaderboard(cmd);
+        } else if (mode == "btree") {
+            runBTree(cmd);
+        } else if (mode == "snapshots") {
+            runSnapshots(cmd);
+        } else if (mode == "shm-load") {
+            runShmLoad(cmd);
+        } else if (mode == "shm-attach") {
+            runShmAttach(cmd);
+        } else if (mode == "shm-unlink") {
+            runShmUnlink(cmd);
+        } else if (mode == "sort-file") {
+            runSortFile(cmd);
+        } else if (mode == "deadline") {
+            runDeadline(cmd);
+        } else if (mode == "progressive") {
+            runProgressive(cmd);
+        } else if (mode == "stream") {
+            runStream(cmd);
+        } else if (mode == "mmap-sort") {
+            runMmapSort(cmd);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (cmd.has("trace")) {
+        std::string trace_file = cmd.get("trace", "trace.json");
+        writeChromeTrace(trace_file);
+        std::cout << "Trace saved to " << trace_file << std::endl;
+    }
 
     std::cout << "Its over!";
 }